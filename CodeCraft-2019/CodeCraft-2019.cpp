@@ -1,7 +1,12 @@
 #include <iostream>
 #include <string>
+#include <vector>
+#include <utility> // std::pair
+#include <stdexcept> // std::invalid_argument, std::out_of_range
 
 #include "model.hpp"
+#include "watchdog.hpp"
+#include "profile.hpp"
 
 int main(int argc, char *argv[])
 {
@@ -27,12 +32,72 @@ int main(int argc, char *argv[])
   std::cout << "presetAnswerPath is " << presetAnswerPath << std::endl;
   std::cout << "answerPath is "       << answerPath       << std::endl;
 
+  // NOTE: optional arguments after the paths.
+  //   --profile=<path>: write phase timing and counters as JSON (needs -DENABLE_PROFILE=ON).
+  //   --renumber=1:     renumber crosses and roads for locality (applied while loading).
+  //   --budget=<ms>:    wall-clock budget, the best plan so far is written when it
+  //                     expires (or on SIGTERM). the plan in progress is still
+  //                     scheduled and judged, no new one is started.
+  //   --<key>=<value>:  override a model parameter, see `Model::set_parameter`.
+  std::string profilePath;
+  bool renumber = false;
+  int  budget    = 0;
+  std::vector<std::pair<std::string, std::string>> options;
+  for (int i = 6; i < argc; ++i) {
+    std::string arg(argv[i]);
+    std::size_t eq = arg.find('=');
+    if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+      std::cout << "ignore argument " << arg << std::endl;
+    } else if (arg.compare(0, 10, "--profile=") == 0) {
+      profilePath = arg.substr(10);
+    } else if (arg.compare(0, 11, "--renumber=") == 0) {
+      renumber = arg.substr(11) != "0";
+    } else if (arg.compare(0, 9, "--budget=") == 0) {
+      // NOTE: a budget that is not a non-negative number is ignored, not thrown.
+      std::string ms = arg.substr(9);
+      std::size_t pos = 0;
+      int v = -1;
+      try {
+        v = std::stoi(ms, &pos);
+      } catch (const std::invalid_argument &) {
+      } catch (const std::out_of_range &) {
+      }
+      if (v < 0 || pos != ms.size()) {
+        std::cout << "ignore argument " << arg << std::endl;
+      } else {
+        budget = v;
+      }
+    } else {
+      options.push_back(std::make_pair(arg.substr(2, eq - 2), arg.substr(eq + 1)));
+    }
+  }
+
+  Watchdog watchdog(budget);
+
   // TODO:read input filebuf
-  Model model(carPath, roadPath, crossPath, presetAnswerPath, answerPath);
+  Model model(carPath, roadPath, crossPath, presetAnswerPath, answerPath, renumber);
+  for (auto &kv : options) {
+    if (!model.set_parameter(kv.first, kv.second)) {
+      std::cout << "ignore unknown or invalid option --" << kv.first << "=" << kv.second << std::endl;
+    }
+  }
+  watchdog.set_verbose(model.is_verbose());
+  watchdog.log("load");
+  model.set_watchdog(&watchdog);
   // TODO:process
   model.run();
   // TODO:write output file
   model.output_answers();
+  watchdog.log("output");
+
+  if (!profilePath.empty()) {
+#ifdef CODECRAFT_PROFILE
+    PROFILE_REPORT(profilePath);
+    std::cout << "profile is " << profilePath << std::endl;
+#else
+    std::cout << "profile is disabled, rebuild with -DENABLE_PROFILE=ON" << std::endl;
+#endif
+  }
 
   return 0;
 }
@@ -0,0 +1,158 @@
+/*
+ * apsp.cpp
+ * Copyright (C) 2019 Guowei Chen <icgw@outlook.com>
+ *
+ * Distributed under terms of the GPL license.
+ */
+
+#include <algorithm> // std::sort, std::unique, std::min
+
+#include "apsp.hpp"
+#include "parallel.hpp"
+#include "profile.hpp"
+
+TravelTimeTable::TravelTimeTable(const Network &network,
+                                 const std::vector<int> &car_speeds,
+                                 const std::size_t max_bytes,
+                                 const int threads)
+  : network_(network)
+  , size_(network.cross_size())
+  , stride_((network.cross_size() + BLOCK - 1) / BLOCK * BLOCK)
+  , threads_(std::max(1, threads))
+  , is_built_(false)
+  , max_speed_(0)
+{
+  PROFILE_PHASE("apsp");
+
+  for (auto r = 0; r < this->network_.road_size(); ++r) {
+    this->max_speed_ = std::max(this->max_speed_, this->network_.road(r).speed);
+  }
+
+  std::vector<int> speeds;
+  for (auto v : car_speeds) {
+    speeds.push_back(std::min(v, this->max_speed_));
+  }
+  std::sort(speeds.begin(), speeds.end());
+  speeds.erase(std::unique(speeds.begin(), speeds.end()), speeds.end());
+
+  // NOTE: dist + next, int32 each.
+  std::size_t bytes = speeds.size() * (std::size_t) this->stride_ * this->stride_ * 2 * sizeof(int);
+  if (speeds.empty() || bytes > max_bytes) {
+    return;
+  }
+
+  this->speed_to_slot_.assign(this->max_speed_ + 1, -1);
+  this->dist_.resize(speeds.size());
+  this->next_.resize(speeds.size());
+  int sz = speeds.size();
+  for (auto s = 0; s < sz; ++s) {
+    this->speed_to_slot_[speeds[s]] = s;
+    this->build(s, speeds[s]);
+  }
+  this->is_built_ = true;
+}
+
+void
+TravelTimeTable::relax(int *dist,
+                       int *next,
+                       const int ib,
+                       const int kb,
+                       const int jb)
+  const
+{
+  const int n = this->stride_;
+  for (auto k = kb; k < kb + BLOCK; ++k) {
+    const int *dk = dist + (std::size_t) k * n + jb;
+    for (auto i = ib; i < ib + BLOCK; ++i) {
+      const int dik = dist[(std::size_t) i * n + k];
+      const int nik = next[(std::size_t) i * n + k];
+      if (dik >= INF) {
+        continue;
+      }
+      int *di = dist + (std::size_t) i * n + jb;
+      int *ni = next + (std::size_t) i * n + jb;
+      // NOTE: branch-free, vectorized by the compiler.
+      for (auto j = 0; j < BLOCK; ++j) {
+        const int c  = dik + dk[j];
+        const int dj = di[j];
+        const int nj = ni[j];
+        ni[j] = (c < dj) ? nik : nj;
+        di[j] = (c < dj) ? c   : dj;
+      }
+    }
+  }
+  return;
+}
+
+void
+TravelTimeTable::build(const int s,
+                       const int speed)
+{
+  const int n = this->stride_;
+  std::vector<int> &dist = this->dist_[s];
+  std::vector<int> &next = this->next_[s];
+  dist.assign((std::size_t) n * n, INF);
+  next.assign((std::size_t) n * n, -1);
+
+  for (auto c = 0; c < this->size_; ++c) {
+    dist[(std::size_t) c * n + c] = 0;
+    next[(std::size_t) c * n + c] = c;
+    for (auto e = this->network_.out_begin(c); e != this->network_.out_end(c); ++e) {
+      int w = this->network_.travel_time(*e, speed);
+      int v = this->network_.edge_to(*e);
+      if (w < dist[(std::size_t) c * n + v]) {
+        dist[(std::size_t) c * n + v] = w;
+        next[(std::size_t) c * n + v] = v;
+      }
+    }
+  }
+
+  // NOTE: round kb: the diagonal tile, then its row and column, then the rest.
+  int nb = n / BLOCK;
+  int *d = dist.data(), *nx = next.data();
+  for (auto b = 0; b < nb; ++b) {
+    int kb = b * BLOCK;
+    this->relax(d, nx, kb, kb, kb);
+
+    parallel_for(2 * nb, this->threads_, [&](const int t, const int) {
+      int x = (t >> 1) * BLOCK;
+      if (x == kb) {
+        return;
+      }
+      if (t & 1) {
+        this->relax(d, nx, x, kb, kb);
+      } else {
+        this->relax(d, nx, kb, kb, x);
+      }
+    });
+
+    parallel_for(nb * nb, this->threads_, [&](const int t, const int) {
+      int ib = (t / nb) * BLOCK, jb = (t % nb) * BLOCK;
+      if (ib != kb && jb != kb) {
+        this->relax(d, nx, ib, kb, jb);
+      }
+    });
+  }
+  return;
+}
+
+bool
+TravelTimeTable::path(const int from,
+                      const int to,
+                      const int speed,
+                      std::vector<int> &cross_seq)
+  const
+{
+  cross_seq.clear();
+  if (this->distance(from, to, speed) < 0) {
+    return false;
+  }
+
+  const std::vector<int> &next = this->next_[this->slot(speed)];
+  cross_seq.push_back(from);
+  for (int c = from; c != to; ) {
+    c = next[(std::size_t) c * this->stride_ + to];
+    cross_seq.push_back(c);
+  }
+  return true;
+}
@@ -0,0 +1,96 @@
+/*
+ * apsp.hpp
+ * Copyright (C) 2019 Guowei Chen <icgw@outlook.com>
+ *
+ * Distributed under terms of the GPL license.
+ */
+
+#ifndef _APSP_HPP_
+#define _APSP_HPP_
+
+#include <cstddef> // std::size_t
+#include <vector>
+
+#include "network.hpp"
+
+/*
+ * NOTE: all-pairs free-flow travel time, one matrix per effective speed.
+ *   -- a car faster than every road behaves like the fastest road, so car
+ *      speeds are clamped to the max road speed before deduplication.
+ *   -- blocked Floyd-Warshall over int32 tiles of `BLOCK` x `BLOCK`, the inner
+ *      loop is branch-free so the compiler vectorizes it, the independent
+ *      tiles of each round run in parallel.
+ *   -- next_: the cross after `from` on a shortest route to `to`.
+ *   -- nothing is built if the matrices would exceed `max_bytes`, then
+ *      `is_built()` is false and callers search on demand.
+ */
+class TravelTimeTable {
+public:
+  TravelTimeTable(const Network &network,
+                  const std::vector<int> &car_speeds,
+                  const std::size_t max_bytes,
+                  const int threads);
+
+  bool is_built() const;
+
+  // NOTE: shortest free-flow travel time, -1 if unreachable or not built.
+  int distance(const int from, const int to, const int speed) const;
+
+  // NOTE: cross index sequence of a shortest route, false if unreachable or not built.
+  bool path(const int from, const int to, const int speed, std::vector<int> &cross_seq) const;
+
+private:
+  TravelTimeTable() = delete;
+
+  enum { BLOCK = 32, INF = 0x3fffffff / 2 };
+
+  int  slot(const int speed) const;
+  void build(const int s, const int speed);
+
+  // NOTE: relax tile (ib, jb) through the crosses of tile kb.
+  void relax(int *dist, int *next, const int ib, const int kb, const int jb) const;
+
+  const Network   &network_;
+  int              size_;
+  int              stride_;
+  int              threads_;
+  bool             is_built_;
+
+  // NOTE: effective speed --> matrix slot, -1 if absent.
+  std::vector<int> speed_to_slot_;
+  int              max_speed_;
+
+  std::vector<std::vector<int>> dist_;
+  std::vector<std::vector<int>> next_;
+};
+
+inline bool
+TravelTimeTable::is_built()
+  const
+{
+  return this->is_built_;
+}
+
+inline int
+TravelTimeTable::slot(const int speed)
+  const
+{
+  int v = speed < this->max_speed_ ? speed : this->max_speed_;
+  return (v > 0 && v < (int) this->speed_to_slot_.size()) ? this->speed_to_slot_[v] : -1;
+}
+
+inline int
+TravelTimeTable::distance(const int from,
+                          const int to,
+                          const int speed)
+  const
+{
+  int s = this->is_built_ ? this->slot(speed) : -1;
+  if (s < 0) {
+    return -1;
+  }
+  int d = this->dist_[s][from * this->stride_ + to];
+  return d >= INF ? -1 : d;
+}
+
+#endif // ifndef _APSP_HPP_
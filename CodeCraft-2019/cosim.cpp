@@ -0,0 +1,159 @@
+/*
+ * cosim.cpp
+ * Copyright (C) 2019 Guowei Chen <icgw@outlook.com>
+ *
+ * Distributed under terms of the GPL license.
+ */
+
+#include <algorithm> // std::sort, std::max
+
+#include "cosim.hpp"
+#include "parallel.hpp"
+#include "profile.hpp"
+#include "judge/judge.hpp"
+
+CoSimulation::CoSimulation(const std::string &car_path,
+                           const std::string &road_path,
+                           const std::string &cross_path,
+                           const std::string &preset_path,
+                           const bool renumber,
+                           const PathEngine &engine,
+                           const int threads,
+                           const double load_weight,
+                           const double margin)
+  : car_path_(car_path)
+  , road_path_(road_path)
+  , cross_path_(cross_path)
+  , preset_path_(preset_path)
+  , renumber_(renumber)
+  , engine_(engine)
+  , threads_(std::max(1, threads))
+  , load_weight_(load_weight)
+  , margin_(margin)
+  , schedule_time_(0)
+  , all_schedule_time_(0)
+{
+}
+
+double
+CoSimulation::route_time(const std::vector<int> &row,
+                         const std::vector<double> &factor)
+  const
+{
+  const Network &network = this->engine_.network();
+  int car   = network.car_index(row[0]);
+  int speed = network.car(car).speed;
+  int c     = network.car_from(car);
+  int sz    = row.size();
+  double ret = 0.0;
+  for (auto i = 2; i < sz; ++i) {
+    int r = network.road_index(row[i]);
+    int e = (r < 0) ? -1 : network.edge_of(r, c);
+    if (e < 0) {
+      return -1.0;
+    }
+    ret += this->engine_.edge_cost(e, speed) * factor[e];
+    c    = network.edge_to(e);
+  }
+  return ret;
+}
+
+bool
+CoSimulation::run(const std::vector<std::vector<int>> &plan,
+                  const bool reroute,
+                  const std::atomic<bool> *stop,
+                  std::vector<std::vector<int>> &answers)
+{
+  PROFILE_PHASE("cosim");
+
+  const Network &network = this->engine_.network();
+  Judge judge(this->car_path_, this->road_path_, this->cross_path_, this->preset_path_, "", this->renumber_);
+
+  // NOTE: the plan lines in start time order, then car id.
+  answers = plan;
+  std::sort(answers.begin(), answers.end(),
+      [](const std::vector<int> &a, const std::vector<int> &b) -> bool {
+        return a[1] < b[1] || (a[1] == b[1] && a[0] < b[0]);
+      });
+
+  int esz = network.edge_size();
+  std::vector<double> factor(esz, 1.0);
+  std::vector<PathEngine::SearchBuffer> bufs(this->threads_);
+  std::vector<Route> routes;
+
+  // NOTE: a plan that neither finishes nor deadlocks (a car that can never
+  //       move) is given up, after the last car left or `max_ticks` at most.
+  const int max_ticks = 1 << 20;
+
+  int n     = answers.size();
+  int next  = 0;
+  int timer = 0;
+  while (true) {
+    ++timer;
+    if (timer > max_ticks) {
+      return false;
+    }
+
+    /*{{{ route the cars starting now, then lock them in */
+    int first = next;
+    while (next < n && answers[next][1] <= timer) {
+      ++next;
+    }
+    if (reroute && next > first) {
+      for (auto e = 0; e < esz; ++e) {
+        if (network.edge_valid(e)) {
+          const RawRoad &rd = network.road(network.edge_road(e));
+          factor[e] = 1.0 + this->load_weight_ * judge.get_num_of_running_cars(e) / (rd.len * rd.channel);
+        }
+      }
+
+      routes.assign(next - first, Route());
+      std::vector<char> is_found(next - first, 0);
+      parallel_for(next - first, std::min(this->threads_, next - first), [&](const int i, const int tid) {
+        int c = network.car_index(answers[first + i][0]);
+        is_found[i] = this->engine_.shortest(network.car_from(c), network.car_to(c), network.car(c).speed,
+                                             factor, bufs[tid], routes[i]);
+        if (is_found[i]) {
+          double t = 0.0;
+          for (auto e : routes[i].edges) {
+            t += this->engine_.edge_cost(e, network.car(c).speed) * factor[e];
+          }
+          double plan = this->route_time(answers[first + i], factor);
+          is_found[i] = plan < 0.0 || t < (1.0 - this->margin_) * plan;
+        }
+      });
+
+      for (auto i = 0; i < next - first; ++i) {
+        if (!is_found[i]) {
+          continue; // XXX: keep the plan route.
+        }
+        std::vector<int> &row = answers[first + i];
+        row.resize(2);
+        for (auto e : routes[i].edges) {
+          row.push_back(network.road(network.edge_road(e)).id);
+        }
+      }
+    }
+    for (auto i = first; i < next; ++i) {
+      judge.add_car_path(answers[i]);
+    }
+    /*}}}*/
+
+    if (!judge.step(timer)) {
+      return false; // XXX: deadlock.
+    }
+    if (stop != nullptr && stop->load()) {
+      return false;
+    }
+    if (next == n && judge.is_finish()) {
+      break;
+    }
+    if (next == n && judge.next_time(timer) < 0) {
+      return false; // XXX: no car left to move, but some never finish.
+    }
+  }
+
+  this->schedule_time_     = timer;
+  this->all_schedule_time_ = judge.get_all_schedule_time();
+  return true;
+}
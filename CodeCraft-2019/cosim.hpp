@@ -0,0 +1,82 @@
+/*
+ * cosim.hpp
+ * Copyright (C) 2019 Guowei Chen <icgw@outlook.com>
+ *
+ * Distributed under terms of the GPL license.
+ */
+
+#ifndef _COSIM_HPP_
+#define _COSIM_HPP_
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "path_engine.hpp"
+
+/*
+ * NOTE: runs a plan through the judge engine in process, tick by tick.
+ *   -- `plan`: answer lines (car id, start time, road id, ...) of the non-preset cars.
+ *   -- reroute: each car is routed again at its start tick, on free-flow time
+ *      scaled by `1 + load_weight_ * cars / (len * channel)` of every directed road
+ *      at that moment, and the route is locked in. the plan route is kept unless
+ *      the new one is faster by more than `margin` of its time, so the plan's
+ *      spread over routes survives. the cars of one tick are routed in parallel.
+ *   -- the judge is built with the same files and `renumber` as the engine's
+ *      network, so both share the directed road indices.
+ */
+class CoSimulation {
+public:
+  CoSimulation(const std::string &car_path,
+               const std::string &road_path,
+               const std::string &cross_path,
+               const std::string &preset_path,
+               const bool renumber,
+               const PathEngine &engine,
+               const int threads,
+               const double load_weight,
+               const double margin);
+
+  // NOTE: false on deadlock, when `stop` is raised, or when some car can never finish.
+  //   -- OUT: answers, the lines as simulated.
+  bool run(const std::vector<std::vector<int>> &plan,
+           const bool reroute,
+           const std::atomic<bool> *stop,
+           std::vector<std::vector<int>> &answers);
+
+  // NOTE: of the last successful `run`, as the judge reports them.
+  int       schedule_time() const;
+  long long all_schedule_time() const;
+
+private:
+  CoSimulation() = delete;
+
+  std::string       car_path_, road_path_, cross_path_, preset_path_;
+  bool              renumber_;
+  const PathEngine &engine_;
+  int               threads_;
+  double            load_weight_;
+  double            margin_;
+
+  // NOTE: time of the answer line's route under `factor`, -1 if it is not a route.
+  double route_time(const std::vector<int> &row, const std::vector<double> &factor) const;
+
+  int               schedule_time_;
+  long long         all_schedule_time_;
+};
+
+inline int
+CoSimulation::schedule_time()
+  const
+{
+  return this->schedule_time_;
+}
+
+inline long long
+CoSimulation::all_schedule_time()
+  const
+{
+  return this->all_schedule_time_;
+}
+
+#endif // ifndef _COSIM_HPP_
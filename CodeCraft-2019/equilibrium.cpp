@@ -0,0 +1,266 @@
+/*
+ * equilibrium.cpp
+ * Copyright (C) 2019 Guowei Chen <icgw@outlook.com>
+ *
+ * Distributed under terms of the GPL license.
+ */
+
+#include <iostream>
+#include <chrono>   // std::chrono::steady_clock
+#include <cmath>    // std::pow
+#include <algorithm> // std::all_of, std::reverse
+#include <unordered_map>
+
+#include "equilibrium.hpp"
+#include "parallel.hpp"
+#include "profile.hpp"
+
+Equilibrium::Equilibrium(const PathEngine &engine,
+                         const std::vector<double> &capacity,
+                         const std::vector<double> &background,
+                         const int threads,
+                         const int sssp_delta)
+  : engine_(engine)
+  , capacity_(capacity)
+  , background_(background)
+  , threads_(std::max(1, threads))
+  , sssp_delta_(sssp_delta)
+  , alpha_(0.15)
+  , beta_(4.0)
+  , link_flow_(capacity.size(), 0.0)
+  , factor_(capacity.size(), 1.0)
+{
+}
+
+int
+Equilibrium::add_demand(const int from,
+                        const int to,
+                        const int speed,
+                        const double volume)
+{
+  this->demands_.push_back(Demand{ from, to, speed, volume });
+  this->paths_.push_back(std::vector<Route>());
+  this->flows_.push_back(std::vector<double>());
+  return this->demands_.size() - 1;
+}
+
+void
+Equilibrium::update_factor()
+{
+  int sz = this->capacity_.size();
+  for (auto e = 0; e < sz; ++e) {
+    this->link_flow_[e] = this->background_[e];
+  }
+  int dsz = this->demands_.size();
+  for (auto d = 0; d < dsz; ++d) {
+    int k = this->paths_[d].size();
+    for (auto i = 0; i < k; ++i) {
+      for (auto e : this->paths_[d][i].edges) {
+        this->link_flow_[e] += this->flows_[d][i];
+      }
+    }
+  }
+  for (auto e = 0; e < sz; ++e) {
+    double ratio = this->link_flow_[e] / std::max(1.0, this->capacity_[e]);
+    this->factor_[e] = 1.0 + this->alpha_ * std::pow(ratio, this->beta_);
+  }
+  return;
+}
+
+double
+Equilibrium::route_time(const Route &r,
+                        const int speed)
+  const
+{
+  double ret = 0.0;
+  for (auto e : r.edges) {
+    ret += this->engine_.edge_cost(e, speed) * this->factor_[e];
+  }
+  return ret;
+}
+
+double
+Equilibrium::all_or_nothing(std::vector<Route> &aon)
+{
+  int dsz = this->demands_.size();
+  aon.resize(dsz);
+
+  int workers = std::max(1, std::min(this->threads_, dsz));
+  std::vector<PathEngine::SearchBuffer> bufs(workers);
+  std::vector<double> sptt(dsz, 0.0);
+  parallel_for(dsz, workers, [&](const int d, const int tid) {
+    const Demand &dm = this->demands_[d];
+    if (this->engine_.shortest(dm.from, dm.to, dm.speed, this->factor_, bufs[tid], aon[d])) {
+      sptt[d] = dm.volume * this->route_time(aon[d], dm.speed);
+    }
+  });
+
+  double ret = 0.0;
+  for (auto t : sptt) {
+    ret += t;
+  }
+  return ret;
+}
+
+void
+Equilibrium::free_flow(std::vector<Route> &aon)
+  const
+{
+  const Network &network = this->engine_.network();
+  int dsz = this->demands_.size();
+  aon.assign(dsz, Route());
+
+  /*{{{ group the demands by (source, speed class) */
+  std::unordered_map<long long, int> key_to_group;
+  std::vector<std::vector<int>> groups;
+  for (auto d = 0; d < dsz; ++d) {
+    const Demand &dm = this->demands_[d];
+    long long key = (long long) network.speed_class(dm.speed) * network.cross_size() + dm.from;
+    auto it = key_to_group.find(key);
+    if (it == key_to_group.end()) {
+      it = key_to_group.insert({ key, (int) groups.size() }).first;
+      groups.push_back(std::vector<int>());
+    }
+    groups[it->second].push_back(d);
+  }
+  /*}}}*/
+
+  // NOTE: many small trees run one per thread, few large ones use every thread each.
+  const int large = 1 << 14;
+  bool is_large   = network.cross_size() >= large;
+  Sssp sssp(network, is_large ? this->threads_ : 1, this->sssp_delta_);
+  auto tree = [&](const int g, std::vector<int> &dist, std::vector<int> &pred) {
+    const Demand &first = this->demands_[groups[g].front()];
+    if (is_large) {
+      sssp.delta_stepping(first.from, first.speed, dist, pred);
+    } else {
+      sssp.dijkstra(first.from, first.speed, dist, pred);
+    }
+    for (auto d : groups[g]) {
+      const Demand &dm = this->demands_[d];
+      if (dist[dm.to] < 0) {
+        continue; // XXX: unreachable.
+      }
+      Route &r = aon[d];
+      for (int c = dm.to; c != dm.from; c = network.edge_from(pred[c])) {
+        r.edges.push_back(pred[c]);
+      }
+      std::reverse(r.edges.begin(), r.edges.end());
+      r.cross_seq.push_back(dm.from);
+      for (auto e : r.edges) {
+        r.cross_seq.push_back(network.edge_to(e));
+      }
+      r.cost = dist[dm.to];
+    }
+  };
+
+  int gsz = groups.size();
+  if (is_large) {
+    std::vector<int> dist, pred;
+    for (auto g = 0; g < gsz; ++g) {
+      tree(g, dist, pred);
+    }
+  } else {
+    int workers = std::max(1, std::min(this->threads_, gsz));
+    std::vector<std::vector<int>> dists(workers), preds(workers);
+    parallel_for(gsz, workers, [&](const int g, const int tid) {
+      tree(g, dists[tid], preds[tid]);
+    });
+  }
+  return;
+}
+
+void
+Equilibrium::average(const std::vector<Route> &aon,
+                     const double step)
+{
+  int dsz = this->demands_.size();
+  for (auto d = 0; d < dsz; ++d) {
+    if (aon[d].cross_seq.empty()) {
+      continue; // XXX: unreachable.
+    }
+    std::vector<Route>  &paths = this->paths_[d];
+    std::vector<double> &flows = this->flows_[d];
+    int k = paths.size();
+    int hit = -1;
+    for (auto i = 0; i < k; ++i) {
+      flows[i] *= 1.0 - step;
+      if (paths[i].edges == aon[d].edges) {
+        hit = i;
+      }
+    }
+    if (hit < 0) {
+      paths.push_back(aon[d]);
+      flows.push_back(0.0);
+      hit = k;
+    }
+    flows[hit] += step * this->demands_[d].volume;
+  }
+  return;
+}
+
+double
+Equilibrium::solve(const int max_iter,
+                   const double max_gap,
+                   const std::atomic<bool> *stop,
+                   const bool verbose)
+{
+  PROFILE_PHASE("equilibrium");
+
+  typedef std::chrono::steady_clock Clock;
+  std::vector<Route> aon;
+
+  // NOTE: iteration 0 loads the shortest routes under the background load,
+  //       without any (no preset, no base factor) every weight is free-flow
+  //       and the demands share one tree per (source, speed class).
+  // XXX: the bundled maps have preset cars, on real inputs the Sssp trees are
+  //      a fallback for preset-free maps only. a free-flow start regardless of
+  //      the background does not route better.
+  this->update_factor();
+  bool is_free = !this->engine_.has_base_factor()
+    && std::all_of(this->background_.begin(), this->background_.end(), [](const double x) { return x <= 0.0; });
+  if (is_free) {
+    this->free_flow(aon);
+  } else {
+    this->all_or_nothing(aon);
+  }
+  this->average(aon, 1.0);
+
+  double gap = 1.0;
+  for (auto n = 1; n <= max_iter; ++n) {
+    auto begin = Clock::now();
+
+    this->update_factor();
+    double tstt = 0.0;
+    int dsz = this->demands_.size();
+    for (auto d = 0; d < dsz; ++d) {
+      int k = this->paths_[d].size();
+      for (auto i = 0; i < k; ++i) {
+        tstt += this->flows_[d][i] * this->route_time(this->paths_[d][i], this->demands_[d].speed);
+      }
+    }
+    double sptt = this->all_or_nothing(aon);
+    gap = (tstt > 0.0) ? (tstt - sptt) / tstt : 0.0;
+
+    bool is_converged = gap < max_gap;
+    if (!is_converged) {
+      this->average(aon, 1.0 / (n + 1));
+    }
+
+    if (verbose) {
+      double ms = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+      std::cout << "equilibrium iteration " << n << ": gap = " << gap
+                << ", time = " << ms << " ms" << std::endl;
+    }
+    if (is_converged) {
+      break;
+    }
+    if (stop != nullptr && stop->load()) {
+      if (verbose) {
+        std::cout << "equilibrium stopped at iteration " << n << std::endl;
+      }
+      break;
+    }
+  }
+  return gap;
+}
@@ -0,0 +1,91 @@
+/*
+ * equilibrium.hpp
+ * Copyright (C) 2019 Guowei Chen <icgw@outlook.com>
+ *
+ * Distributed under terms of the GPL license.
+ */
+
+#ifndef _EQUILIBRIUM_HPP_
+#define _EQUILIBRIUM_HPP_
+
+#include <atomic>
+#include <vector>
+
+#include "path_engine.hpp"
+#include "sssp.hpp"
+
+/*
+ * NOTE: user equilibrium by the method of successive averages (MSA).
+ *   -- link delay (BPR): edge_cost(e, speed) * (1 + alpha * (x_e / cap_e) ^ beta).
+ *   -- each iteration routes every demand all-or-nothing on the current delays
+ *      (in parallel), then moves 1 / (n + 1) of the flow onto those routes.
+ *   -- relative gap: (TSTT - SPTT) / TSTT, where TSTT is the total time of the
+ *      current flows and SPTT the total time if everyone took a shortest route.
+ *   -- `background` is the fixed load per directed road (preset cars).
+ *   -- iteration 0 routes every demand under the background load. without
+ *      any (and without a delay table) it takes the free-flow shortest path
+ *      tree of its (source, speed class), one tree per pair, by delta-stepping
+ *      with buckets of `sssp_delta` ticks on large maps.
+ */
+class Equilibrium {
+public:
+  Equilibrium(const PathEngine &engine,
+              const std::vector<double> &capacity,
+              const std::vector<double> &background,
+              const int threads,
+              const int sssp_delta = 16);
+
+  // NOTE: returns the demand index.
+  int add_demand(const int from, const int to, const int speed, const double volume);
+
+  // NOTE: iterate until gap < `max_gap` or `max_iter` iterations, returns the last gap.
+  //   -- `stop`: when raised, return after the current iteration, the flows stay valid.
+  //   -- `verbose`: print the gap and the time of each iteration.
+  double solve(const int max_iter, const double max_gap, const std::atomic<bool> *stop = nullptr,
+               const bool verbose = false);
+
+  // NOTE: the routes of a demand and the flow on each of them (sum to the volume).
+  const std::vector<Route>&  paths(const int d) const { return this->paths_[d]; }
+  const std::vector<double>& flows(const int d) const { return this->flows_[d]; }
+
+private:
+  Equilibrium() = delete;
+
+  struct Demand {
+    int from, to, speed;
+    double volume;
+  };
+
+  // NOTE: link flow --> delay factor of each directed road.
+  void update_factor();
+
+  // NOTE: delay of a route under the current factor.
+  double route_time(const Route &r, const int speed) const;
+
+  // NOTE: free-flow shortest routes for every demand, from one tree per (source, speed class).
+  void free_flow(std::vector<Route> &aon) const;
+
+  // NOTE: all-or-nothing routes for every demand, returns SPTT.
+  double all_or_nothing(std::vector<Route> &aon);
+
+  // NOTE: move `step` of each demand onto its all-or-nothing route.
+  void average(const std::vector<Route> &aon, const double step);
+
+  const PathEngine          &engine_;
+  const std::vector<double> &capacity_;
+  const std::vector<double> &background_;
+  int                        threads_;
+  int                        sssp_delta_;
+  double                     alpha_;
+  double                     beta_;
+
+  std::vector<Demand>              demands_;
+  std::vector<std::vector<Route>>  paths_;
+  std::vector<std::vector<double>> flows_;
+
+  // NOTE: directed road index --> flow, delay factor.
+  std::vector<double> link_flow_;
+  std::vector<double> factor_;
+};
+
+#endif // ifndef _EQUILIBRIUM_HPP_
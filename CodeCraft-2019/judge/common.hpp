@@ -13,7 +13,6 @@ enum State { WAIT, FINAL, FINISH };
 class Identity {
 public:
   Identity(int i) : id_(i) {}
-  virtual ~Identity() {}
 
   int get_id() const;
 
@@ -40,7 +39,6 @@ public:
     , speed_(speed)
     , from_(from)
     , to_(to) {}
-  virtual ~StartEnd() {}
 
   int get_speed() const;
   int get_from()  const;
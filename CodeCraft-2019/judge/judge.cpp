@@ -7,13 +7,159 @@
 
 #include <iostream> // DEBUG
 #include <set>      // FOR DEADLOCK INFO
+#include <map>      // FOR DELAY TABLE
+#include <chrono>   // FOR WAIT STATS
+#include <limits>   // std::numeric_limits
 #include "judge.hpp"
 
 void
 Judge::drive_just_current_road()
 {
-  for (auto &rd : this->roads_) {
-    rd.drive_just_current_road();
+  // NOTE: too few cars to pay the hand-off to the workers.
+  const int min_cars_per_worker = 256;
+
+  int workers = this->pool_ ? this->pool_->size() : 1;
+  int n       = this->roads_.size();
+
+  long long total = 0;
+  if (workers > 1) {
+    // NOTE: a road costs its cars plus one visit of its lanes.
+    this->road_load_.resize(n + 1);
+    this->road_load_[0] = 0;
+    for (auto r = 0; r < n; ++r) {
+      int cars = this->road_occupancy_[r];
+      this->road_load_[r + 1] = this->road_load_[r] + cars + (cars > 0);
+      total += cars;
+    }
+  }
+
+  if (workers <= 1 || total < (long long) workers * min_cars_per_worker) {
+    for (auto r = 0; r < n; ++r) {
+      if (this->road_occupancy_[r] > 0) {
+        this->roads_[r].drive_just_current_road();
+      }
+    }
+    return;
+  }
+
+  // static chunks of about the same load, contiguous in the road order.
+  this->chunk_.assign(workers + 1, n);
+  this->chunk_[0] = 0;
+  for (auto t = 1; t < workers; ++t) {
+    long long target = this->road_load_[n] * t / workers;
+    this->chunk_[t] = std::lower_bound(this->road_load_.begin(), this->road_load_.end(), target) - this->road_load_.begin();
+    this->chunk_[t] = std::max(this->chunk_[t - 1], std::min(this->chunk_[t], n));
+  }
+
+  this->pool_->run([this](const int tid) {
+    for (auto r = this->chunk_[tid]; r < this->chunk_[tid + 1]; ++r) {
+      if (this->road_occupancy_[r] > 0) {
+        this->roads_[r].drive_just_current_road();
+      }
+    }
+  });
+  return;
+}
+
+void
+Judge::set_threads(const int threads)
+{
+  if (threads <= 1) {
+    this->pool_.reset();
+  } else if (!this->pool_ || this->pool_->size() != threads) {
+    this->pool_.reset(new WorkerPool(threads));
+  }
+  this->partition_regions(this->pool_ ? this->pool_->size() : 1);
+  return;
+}
+
+// NOTE: the sweep goes over the crosses by id, on the maps (ids row by row)
+//       a band of regions side by side then sweeps along together, while
+//       regions stacked one after another would wait for each other in turn.
+//       so the first `width` positions are cut into `num` runs, and a later
+//       cross takes the region of its neighbour of the lowest position
+//       (the one above it), with `width` the usual gap to that neighbour.
+void
+Judge::partition_regions(const int num)
+{
+  int sz = this->crosses_.size();
+
+  // position --> positions of the neighbours.
+  std::vector<std::vector<int>> adj(sz);
+  for (auto p = 0; p < sz; ++p) {
+    Cross &c = this->crosses_[this->cross_order_[p]];
+    for (auto r : c.get_roads()) {
+      auto other = (r->get_to() == c.get_id()) ? r->get_from() : r->get_to();
+      adj[p].push_back(this->order_pos_[this->network_.cross_index(other)]);
+    }
+  }
+
+  this->region_of_.assign(sz, 0);
+  if (num > 1) {
+    std::vector<int> gaps;
+    for (auto p = 0; p < sz; ++p) {
+      int low = p;
+      for (auto q : adj[p]) {
+        low = std::min(low, q);
+      }
+      if (low < p) {
+        gaps.push_back(p - low);
+      }
+    }
+    int width = sz;
+    if (!gaps.empty()) {
+      std::nth_element(gaps.begin(), gaps.begin() + gaps.size() / 2, gaps.end());
+      width = std::max(num, std::min(sz, gaps[gaps.size() / 2]));
+    }
+
+    std::vector<int> count(num, 0);
+    for (auto p = 0; p < sz; ++p) {
+      int g = -1;
+      if (p < width) {
+        g = (long long) p * num / width;
+      } else {
+        int low = p;
+        for (auto q : adj[p]) {
+          low = std::min(low, q);
+        }
+        if (low < p) {
+          g = this->region_of_[low];
+        } else {
+          g = std::min_element(count.begin(), count.end()) - count.begin();
+        }
+      }
+      this->region_of_[p] = g;
+      ++count[g];
+    }
+  }
+
+  this->regions_.clear();
+  for (auto g = 0; g < num; ++g) {
+    this->regions_.push_back(std::unique_ptr<Region>(new Region()));
+  }
+
+  // late crosses and what they wait for, the last position per foreign region.
+  for (auto p = 0; p < sz; ++p) {
+    int g = this->region_of_[p];
+    std::map<int, int> need;
+    for (auto q : adj[p]) {
+      int h = this->region_of_[q];
+      if (h != g && q < p) {
+        need[h] = std::max(need[h], q);
+      }
+    }
+    if (need.empty()) {
+      continue;
+    }
+    Region &rg = *this->regions_[g];
+    rg.late.push_back(p);
+    rg.need_begin.push_back(rg.need.size());
+    for (auto &kv : need) {
+      rg.need.push_back(kv);
+    }
+  }
+  for (auto &rg : this->regions_) {
+    rg->need_begin.push_back(rg->need.size());
   }
   return;
 }
@@ -22,8 +168,11 @@ void
 Judge::drive_car_init_list(const int current_time,
                            const bool is_priority)
 {
-  for (auto &rd : this->roads_) {
-    rd.run_car_in_init_list(current_time, is_priority);
+  int n = this->roads_.size();
+  for (auto r = 0; r < n; ++r) {
+    if (this->road_occupancy_[r] > 0) {
+      this->roads_[r].run_car_in_init_list(current_time, is_priority);
+    }
   }
   return;
 }
@@ -31,63 +180,398 @@ Judge::drive_car_init_list(const int current_time,
 void
 Judge::create_car_sequence()
 {
-  for (auto &rd : this->roads_) {
+  // NOTE: the first sweep of the wait phase visits the crosses with a car waiting to pass.
+  // NOTE: an idle road has no waiting car left from the last wait phase.
+  this->num_of_wait_car_ = 0;
+  int sz = this->roads_.size();
+  for (auto r = 0; r < sz; ++r) {
+    if (0 == this->road_occupancy_[r]) {
+      continue;
+    }
+    RoadOnline &rd = this->roads_[r];
     rd.create_car_in_wait_sequence();
+
+    int n = rd.get_num_of_wait_cars(0);
+    if (n > 0) {
+      this->touch_cross(rd.get_to(), -1, -1);
+      this->num_of_wait_car_ += n;
+    }
+    if (rd.get_from() != rd.get_to() && (n = rd.get_num_of_wait_cars(1)) > 0) {
+      this->touch_cross(rd.get_from(), -1, -1);
+      this->num_of_wait_car_ += n;
+    }
+  }
+  return;
+}
+void
+Judge::touch_cross(const int cross_id,
+                   const int from_pos,
+                   const int from_region)
+{
+  auto p = this->order_pos_[this->network_.cross_index(cross_id)];
+  auto g = this->region_of_[p];
+  if (from_region >= 0 && g != from_region) {
+    Region &rg = *this->regions_[g];
+    std::lock_guard<std::mutex> lock(rg.inbox_mtx);
+    rg.inbox.push_back(std::make_pair(p, (char) (p > from_pos)));
+    return;
+  }
+  this->push_sweep(g, p, p > from_pos);
+  return;
+}
+
+void
+Judge::touch_road(const RoadOnline *road,
+                  const int from_pos,
+                  const int from_region)
+{
+  ++(this->road_version_[road - this->roads_.data()]);
+  this->touch_cross(road->get_from(), from_pos, from_region);
+  this->touch_cross(road->get_to(), from_pos, from_region);
+  return;
+}
+
+void
+Judge::push_sweep(const int region,
+                  const int pos,
+                  const bool in_this_sweep)
+{
+  Region &rg = *this->regions_[region];
+  if (in_this_sweep) {
+    if (!this->in_sweep_[pos]) {
+      this->in_sweep_[pos] = 1;
+      rg.sweep.push(pos);
+    }
+  } else if (!this->in_next_sweep_[pos]) {
+    this->in_next_sweep_[pos] = 1;
+    rg.next.push(pos);
   }
   return;
 }
+
+void
+Judge::drain_inbox(const int region)
+{
+  Region &rg = *this->regions_[region];
+  std::lock_guard<std::mutex> lock(rg.inbox_mtx);
+  for (auto &t : rg.inbox) {
+    this->push_sweep(region, t.first, t.second);
+  }
+  rg.inbox.clear();
+  return;
+}
+
+void
+Judge::clear_next_sweep()
+{
+  for (auto &rg : this->regions_) {
+    while (!rg->next.empty()) {
+      this->in_next_sweep_[rg->next.top()] = 0;
+      rg->next.pop();
+    }
+  }
+  return;
+}
+
+int
+Judge::resolve_cross(const int pos,
+                     const int current_time,
+                     const int region)
+{
+  int delta = 0;
+  Cross &c = this->crosses_[this->cross_order_[pos]];
+  CarTable &cars = this->cars_;
+  for (auto r : c.get_roads()) {
+    // NOTE: the cars of `r` driving into `c`.
+    auto dir    = (r->get_to() == c.get_id()) ? 0 : 1;
+    auto before = r->get_num_of_wait_cars(dir);
+    int car;
+    while ((car = r->get_front_car_from_wait_sequence(dir)) >= 0) {
+      if (cars.is_conflict(car)) {
+        // XXX: something error.
+        std::cout << "conflict.\n";
+        break;
+      }
+
+      auto prev_channel = cars.channel[car];
+      if (cars.move_to_next_road(car)) {
+        if (cars.state[car] == WAIT) {
+          std::cout << "STILL WAIT.\n";
+        }
+        r->drive_just_current_road(prev_channel, dir, true);
+        r->update_wait_sequence(prev_channel, dir);
+        r->run_car_in_init_list(current_time, true);
+
+        this->touch_road(r, pos, region);
+        if (FINISH != cars.state[car]) {
+          this->touch_road(cars.hop_road_online(car, cars.hop[car]), pos, region);
+        }
+      } else {
+        // NOTE: no slot on its next road.
+        this->block_road(2 * (r - this->roads_.data()) + dir, car, pos, current_time);
+        break;
+      }
+    }
+    delta += r->get_num_of_wait_cars(dir) - before;
+  }
+  return delta;
+}
+
+void
+Judge::block_road(const int edge,
+                  const int car,
+                  const int pos,
+                  const int current_time)
+{
+  const CarTable &cars = this->cars_;
+  auto h = cars.hop[car] + 1;
+  auto next_road = cars.hop_road(car, h);
+  auto next_dir  = cars.hop_dir(car, h);
+
+  WaitFor &w = this->wait_for_[edge];
+  w.next         = -1;
+  w.car          = car;
+  w.tick         = current_time;
+  w.version      = this->road_version_[edge >> 1];
+  w.next_version = this->road_version_[next_road];
+  // NOTE: a priority car may still take a slot of the next road and free the
+  //       car behind it, no link then, the stall check of the sweep stays.
+  if (next_dir >= 0 && !this->roads_[next_road].can_depart_priority(next_dir, current_time)) {
+    w.next = 2 * next_road + next_dir;
+  }
+
+  this->regions_[this->region_of_[pos]]->blocked.push_back(edge);
+  return;
+}
+
 bool
-Judge::drive_car_in_wait_state(const int current_time)
+Judge::is_waiting_for(const int edge,
+                      const int current_time)
+  const
+{
+  const WaitFor &w = this->wait_for_[edge];
+  return w.tick == current_time && w.next >= 0
+      && w.version == this->road_version_[edge >> 1]
+      && w.next_version == this->road_version_[w.next >> 1];
+}
+
+bool
+Judge::find_wait_cycle(const int current_time)
 {
-  // XXX: prev_num_of_wait_car may be exist better implementation.
-  int prev_num_of_wait_car = 0x7fffffff;
-  int num_of_wait_car;
+  // NOTE: the blocked roads in a fixed order, the same cycle whatever the regions.
+  this->blocked_.clear();
+  for (auto &rg : this->regions_) {
+    this->blocked_.insert(this->blocked_.end(), rg->blocked.begin(), rg->blocked.end());
+    rg->blocked.clear();
+  }
+  std::sort(this->blocked_.begin(), this->blocked_.end());
+
+  // NOTE: a walk follows the links until a road seen in this check, it closes a
+  //       cycle if seen in this walk.
+  int first_walk = this->walks_ + 1;
+  for (auto e : this->blocked_) {
+    int walk = ++(this->walks_);
+    int v    = e;
+    while (this->wait_walk_[v] < first_walk && this->is_waiting_for(v, current_time)) {
+      this->wait_walk_[v] = walk;
+      v = this->wait_for_[v].next;
+    }
+    if (this->wait_walk_[v] != walk) {
+      continue;
+    }
+
+    this->cycle_.clear();
+    auto u = v;
+    do {
+      this->cycle_.push_back(u);
+      u = this->wait_for_[u].next;
+    } while (u != v);
+    std::rotate(this->cycle_.begin(), std::min_element(this->cycle_.begin(), this->cycle_.end()), this->cycle_.end());
+    return true;
+  }
+  return false;
+}
+
+// NOTE: the crosses of all regions in position order, on this thread.
+int
+Judge::sweep_serial(const int current_time)
+{
+  int delta = 0;
+  int num   = this->regions_.size();
   while (true) {
-    num_of_wait_car = 0;
-    for (auto &c : this->crosses_) {
-      for (auto r : c.get_roads()) {
-        RunningCar* car;
-        while ((car = r->get_front_car_from_wait_sequence(c.get_id())) != nullptr) {
-          if (car->is_conflict()) {
-            // XXX: something error.
-            std::cout << "conflict.\n";
-            break;
-          }
-
-          auto prev_channel = car->get_current_road_channel();
-          if (car->move_to_next_road()) {
-            if (car->get_state() == WAIT) {
-              std::cout << "STILL WAIT.\n";
-            }
-            r->drive_just_current_road(prev_channel, c.get_id(), true);
-            r->create_car_in_wait_sequence();
-            r->run_car_in_init_list(current_time, true);
-
-            // XXX: something wrong?
-          } else {
-            break;
-          }
-        }
-        num_of_wait_car += r->get_num_of_wait_cars(c.get_id());
+    int best = -1;
+    for (auto g = 0; g < num; ++g) {
+      const Sweep &sw = this->regions_[g]->sweep;
+      if (!sw.empty() && (best < 0 || sw.top() < this->regions_[best]->sweep.top())) {
+        best = g;
       }
     }
+    if (best < 0) {
+      break;
+    }
 
-    if (num_of_wait_car >= prev_num_of_wait_car) {
+    Sweep &sw = this->regions_[best]->sweep;
+    int p = sw.top();
+    sw.pop();
+    this->in_sweep_[p] = 0;
+
+    delta += this->resolve_cross(p, current_time, -1);
+    ++(this->wait_stats_.visits);
+    ++(this->wait_stats_.serial_visits);
+    ++(this->wait_stats_.critical_visits);
+  }
+  return delta;
+}
+
+int
+Judge::sweep_regions(const int current_time)
+{
+  for (auto &rg : this->regions_) {
+    rg->progress.store(-1, std::memory_order_relaxed);
+    rg->wait_delta = rg->visits = rg->stalls = 0;
+  }
+
+  this->pool_->run([this, current_time](const int tid) {
+    this->sweep_region(tid, current_time);
+  });
+
+  // NOTE: touches for the next sweep may come after a region is done.
+  int delta = 0, critical = 0;
+  int num   = this->regions_.size();
+  for (auto g = 0; g < num; ++g) {
+    this->drain_inbox(g);
+
+    Region &rg = *this->regions_[g];
+    delta    += rg.wait_delta;
+    critical  = std::max(critical, rg.visits);
+    this->wait_stats_.visits += rg.visits;
+    this->wait_stats_.stalls += rg.stalls;
+  }
+  this->wait_stats_.critical_visits += critical;
+  return delta;
+}
+
+void
+Judge::sweep_region(const int region,
+                    const int current_time)
+{
+  const int inf = std::numeric_limits<int>::max();
+
+  Region &rg = *this->regions_[region];
+  std::size_t li = 0;
+  bool stalled = false;
+  while (true) {
+    this->drain_inbox(region);
+
+    int top   = rg.sweep.empty() ? inf : rg.sweep.top();
+    int late  = (li < rg.late.size()) ? rg.late[li] : inf;
+    int bound = std::min(top, late);
+    rg.progress.store((inf == bound) ? inf : bound - 1, std::memory_order_release);
+    if (inf == bound) {
       break;
     }
 
+    if (late <= top) {
+      // NOTE: the touches of the foreign neighbours are in the inbox once they
+      //       are passed, so drain it again before going on.
+      bool passed = true;
+      for (auto k = rg.need_begin[li]; k < rg.need_begin[li + 1] && passed; ++k) {
+        auto &nd = rg.need[k];
+        passed = this->regions_[nd.first]->progress.load(std::memory_order_acquire) >= nd.second;
+      }
+      if (passed) {
+        ++li;
+        stalled = false;
+      } else {
+        if (!stalled) {
+          ++rg.stalls;
+          stalled = true;
+        }
+        std::this_thread::yield();
+      }
+      continue;
+    }
+
+    rg.sweep.pop();
+    this->in_sweep_[top] = 0;
+    rg.wait_delta += this->resolve_cross(top, current_time, region);
+    ++rg.visits;
+  }
+  return;
+}
+
+bool
+Judge::drive_car_in_wait_state(const int current_time)
+{
+  // NOTE: too few crosses in a sweep to pay the hand-off to the workers.
+  const int min_crosses_per_worker = 64;
+
+  this->wait_stats_ = WaitStats();
+  auto start = std::chrono::steady_clock::now();
+
+  // NOTE: the first sweep is filled by create_car_sequence().
+  for (auto &rg : this->regions_) {
+    rg->blocked.clear();
+  }
+  int num_of_wait_car = this->num_of_wait_car_;
+  bool ok = true;
+  int num = this->regions_.size();
+  while (num_of_wait_car > 0) {
+    int prev_num_of_wait_car = num_of_wait_car;
+
+    std::size_t pending = 0;
+    for (auto &rg : this->regions_) {
+      pending += rg->sweep.size();
+    }
+    ++(this->wait_stats_.sweeps);
+    if (num > 1 && pending >= (std::size_t) num * min_crosses_per_worker) {
+      num_of_wait_car += this->sweep_regions(current_time);
+    } else {
+      num_of_wait_car += this->sweep_serial(current_time);
+    }
+
     if (num_of_wait_car == 0) {
-      return true;
+      break;
     }
 
-    prev_num_of_wait_car = num_of_wait_car;
+    // NOTE: a cycle of the wait-for graph never moves again, no more sweeps.
+    if (this->find_wait_cycle(current_time)) {
+      ok = false; // deadlock;
+      break;
+    }
+
+    if (num_of_wait_car >= prev_num_of_wait_car) {
+      // XXX: stalled without a cycle of links, see block_road().
+      ok = false; // deadlock;
+      break;
+    }
+
+    for (auto &rg : this->regions_) {
+      rg->sweep.swap(rg->next);
+    }
+    this->in_sweep_.swap(this->in_next_sweep_);
   }
 
-  if (prev_num_of_wait_car > 0) {
-    // XXX: logging which cross deadlock??
-    return false; // deadlock;
+  // NOTE: crosses touched after the last car passed have nothing to do.
+  this->clear_next_sweep();
+
+  this->wait_stats_.usec = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  return ok;
+}
+
+bool
+Judge::step(const int current_time)
+{
+  this->drive_just_current_road();
+  this->drive_car_init_list(current_time, true);
+  this->create_car_sequence();
+
+  if (!this->drive_car_in_wait_state(current_time)) {
+    return false;
   }
 
+  this->drive_car_init_list(current_time, false);
   return true;
 }
 
@@ -107,93 +591,94 @@ Judge::is_finish()
    * return flag;
    */
 
-  for (auto &c : this->cars_) {
-    if (FINISH != c.get_state()) {
-      return false;
-    }
-  }
-  return true;
+  // NOTE: the cars without route are FINISH from the start.
+  return this->cars_.census.finished >= this->cars_.census.routed;
 }
 
 int
 Judge::get_all_schedule_time()
 {
-  int all_schedule_time = 0;
-  for (auto &c : this->cars_) {
-    all_schedule_time += c.get_end_time();
-  }
-  return all_schedule_time;
+  return this->cars_.census.end_time_sum;
 }
 
-void
-Judge::init_car_road_cross(const std::string car_path,
-                           const std::string road_path,
-                           const std::string cross_path)
-{
-  // id, from, to, speed, plan_time, priority, preset
-  constexpr int CAR_COLUMN   = 7;
-  // id, length, speed, channel, from, to, is_duplex
-  constexpr int ROAD_COLUMN  = 7;
-  // id, road_id, road_id, road_id, road_id
-  constexpr int CROSS_COLUMN = 5;
-
-  std::vector<std::vector<int>> cars, roads, crosses;
-  read_from_file(car_path   , CAR_COLUMN   , cars);
-  read_from_file(road_path  , ROAD_COLUMN  , roads);
-  read_from_file(cross_path , CROSS_COLUMN , crosses);
-
-/*{{{ for cars_, m_id_to_pcar_*/
-  for (auto &c : cars) {
-    this->cars_.push_back(RunningCar(c[0], c[1], c[2], c[3], c[4], c[5], c[6]));
-  }
-  std::sort(this->cars_.begin(), this->cars_.end(),
-      [](const RunningCar &a, const RunningCar &b) -> bool {
-        return a.get_id() < b.get_id();
-      });
-  for (auto &c : this->cars_) {
-    this->m_id_to_pcar_[c.get_id()] = &c;
+int
+Judge::next_time(const int current_time)
+{
+  if (this->cars_.census.departed > this->cars_.census.finished) {
+    return current_time + 1;
   }
-/*}}}*/
 
-/*{{{ for roads_, m_id_to_pcar_*/
-  for (auto &r : roads) {
-    this->roads_.push_back(RoadOnline(r[0], r[1], r[2], r[3], r[4], r[5], r[6]));
+  // NOTE: the road is empty, so every car due by now has departed.
+  while (!this->departure_.empty() && this->departure_.top() <= current_time) {
+    this->departure_.pop();
   }
-  std::sort(this->roads_.begin(), this->roads_.end(),
-      [](const RoadOnline &a, const RoadOnline &b) -> bool {
-        return a.get_id() < b.get_id();
-      });
-  for (auto &r : this->roads_) {
-    this->m_id_to_proad_[r.get_id()] = &r;
+  return this->departure_.empty() ? -1 : this->departure_.top();
+}
+
+void
+Judge::init_car_road_cross()
+{
+/*{{{ for cars_, roads_, crosses_ (already sorted by id) */
+  int sz = this->network_.car_size();
+  for (auto i = 0; i < sz; ++i) {
+    const RawCar &c = this->network_.car(i);
+    this->cars_.add(c.id, c.from, c.speed, c.plan_time, c.priority, c.preset);
   }
-/*}}}*/
 
-/*{{{ for crsses_, m_id_to_pcross_*/
-  for (auto &cs : crosses) {
-    this->crosses_.push_back(Cross(cs[0], cs[1], cs[2], cs[3], cs[4]));
+  sz = this->network_.road_size();
+  this->roads_.reserve(sz);
+  this->road_occupancy_.assign(sz, 0);
+  for (auto i = 0; i < sz; ++i) {
+    const RawRoad &r = this->network_.road(i);
+    this->roads_.push_back(RoadOnline(r.id, r.len, r.speed, r.channel, r.from, r.to, r.is_duplex, &this->cars_, &this->road_occupancy_[i]));
   }
-  std::sort(this->crosses_.begin(), this->crosses_.end(),
-      [](const Cross &a, const Cross &b) -> bool {
-        return a.get_id() < b.get_id();
-      });
-  for (auto &cs : this->crosses_) {
-    this->m_id_to_pcross_[cs.get_id()] = &cs;
+  this->cars_.roads = this->roads_.data();
+
+  this->wait_for_.assign(2 * sz, WaitFor{ -1, -1, -1, 0, 0 });
+  this->road_version_.assign(sz, 0);
+  this->wait_walk_.assign(2 * sz, 0);
+  this->walks_ = 0;
+
+  sz = this->network_.cross_size();
+  this->crosses_.reserve(sz);
+  for (auto i = 0; i < sz; ++i) {
+    const RawCross &cs = this->network_.cross(i);
+    this->crosses_.push_back(Cross(cs.id, cs.r1, cs.r2, cs.r3, cs.r4));
   }
 /*}}}*/
 
-  // initiating crosses and ..
-  for (auto &cs : this->crosses_) {
-    cs.init(this->m_id_to_proad_);
-    // initiating m_pair_roads_to_cross_;
-    auto roads = cs.get_roads();
-    auto sz    = roads.size();
-    for (auto i = 0; i < sz; ++i) {
-      for (auto j = 0; j < sz; ++j) {
-        if (i == j) continue;
-        this->m_pair_proads_to_pcross_[std::make_pair(roads[i], roads[j])] = &cs;
+  // initiating crosses, roads id ascending.
+  for (auto i = 0; i < sz; ++i) {
+    std::vector<RoadOnline*> roads;
+    for (auto k = 0; k < 4; ++k) {
+      auto r = this->network_.cross_road(i, k);
+      if (r >= 0) {
+        roads.push_back(&this->roads_[r]);
       }
     }
+    std::sort(roads.begin(), roads.end(),
+        [](RoadOnline* const a, RoadOnline* const b) -> bool {
+          return a->get_id() < b->get_id();
+        });
+    this->crosses_[i].init(roads);
+  }
+
+  this->cross_order_.resize(sz);
+  for (auto i = 0; i < sz; ++i) {
+    this->cross_order_[i] = i;
+  }
+  std::sort(this->cross_order_.begin(), this->cross_order_.end(),
+      [this](const int a, const int b) -> bool {
+        return this->crosses_[a].get_id() < this->crosses_[b].get_id();
+      });
+
+  this->order_pos_.resize(sz);
+  for (auto i = 0; i < sz; ++i) {
+    this->order_pos_[this->cross_order_[i]] = i;
   }
+  this->in_sweep_.assign(sz, 0);
+  this->in_next_sweep_.assign(sz, 0);
+  this->partition_regions(1);
 
   return;
 }
@@ -203,39 +688,83 @@ Judge::init_cars_path(std::vector<std::vector<int>> &schedule,
                       const int b_preset) // IN: 1, preset; IN: 0, not preset.
 {
   for (auto &v : schedule) {
-    auto id = v[0];
-    auto is_preset = this->m_id_to_pcar_[id]->get_preset();
-    if (b_preset != is_preset) {
-      // XXX: logging something error.
-      continue;
-    }
-
-    std::vector<RoadOnline*> this_path;
-    this_path.clear();
-    auto sz = v.size();
-    for (auto i = 2; i < sz; ++i) {
-      this_path.push_back(this->m_id_to_proad_[v[i]]);
-    }
-    this->m_id_to_pcar_[id]->init(v[1], this_path, this->m_pair_proads_to_pcross_, this->m_id_to_pcross_);
+    this->init_car_path(v, b_preset);
   }
   return;
 }
 
+int
+Judge::init_car_path(const std::vector<int> &v,
+                     const int b_preset)
+{
+  auto idx = this->network_.car_index(v[0]);
+  if (idx < 0) {
+    return -1;
+  }
+  if (v.size() <= 2) {
+    // XXX: no road, the car could never finish. it is left unrouted.
+    return -1;
+  }
+  auto is_preset = this->cars_.preset[idx];
+  if (b_preset != is_preset) {
+    // XXX: logging something error.
+    return -1;
+  }
+
+  // NOTE: a road is driven away from its start cross, shared by two successive roads.
+  this->route_.clear();
+  auto prev = -1;
+  int  sz   = v.size();
+  for (auto i = 2; i < sz; ++i) {
+    auto r = this->network_.road_index(v[i]);
+    auto c = (prev < 0) ? this->network_.car_from(idx) : this->network_.shared_cross(prev, r);
+    auto d = (c < 0) ? -1 : this->roads_[r].dir_from(this->crosses_[c].get_id());
+    this->route_.push_back(d < 0 ? ~(2 * r) : 2 * r + d);
+    prev = r;
+  }
+  this->cars_.init(idx, v[1], this->route_.data(), this->route_.data() + this->route_.size());
+  this->departure_.push(v[1]);
+  return idx;
+}
+
+bool
+Judge::add_car_path(const std::vector<int> &row)
+{
+  auto idx = this->init_car_path(row, 0);
+  if (idx < 0) {
+    return false;
+  }
+
+  if (this->cars_.path_size[idx] > 0) {
+    this->cars_.hop_road_online(idx, 0)->push(this->cars_, idx, this->cars_.hop_dir(idx, 0));
+  }
+  return true;
+}
+
 void
-Judge::init_preset_and_answer_path(const std::string preset_path,
-                                   const std::string answer_path)
+Judge::init_preset_and_answer_path(const std::string answer_path)
 {
   std::vector<std::vector<int>> preset, answer;
-  read_from_file(preset_path, preset);
+  for (auto &p : this->network_.preset_cars()) {
+    std::vector<int> v { p.id, p.start_time };
+    v.insert(v.end(), p.road_path.begin(), p.road_path.end());
+    preset.push_back(v);
+  }
   read_from_file(answer_path, answer);
 
+  // NOTE: one allocation for the hops of all routes.
+  std::size_t hops = 0;
+  for (auto &v : preset) hops += (v.size() > 2) ? v.size() - 2 : 0;
+  for (auto &v : answer) hops += (v.size() > 2) ? v.size() - 2 : 0;
+  this->cars_.path_arena.reserve(hops);
+
   this->init_cars_path(preset, 1);
   this->init_cars_path(answer, 0);
 
-  for (auto &cr : this->cars_) {
-    RoadOnline* road = cr.get_src_road();
-    if (road) {
-      road->push(&cr, cr.get_from());
+  int sz = this->cars_.size();
+  for (auto i = 0; i < sz; ++i) {
+    if (this->cars_.path_size[i] > 0) {
+      this->cars_.hop_road_online(i, 0)->push(this->cars_, i, this->cars_.hop_dir(i, 0));
     }
   }
 
@@ -250,13 +779,36 @@ Judge::deadlock_info()
   this->overload_road_id_.clear();
 
   int n = 0;
-  for (auto &cr : this->cars_) {
-    if (WAIT != cr.get_state()) {
+  const CarTable &cars = this->cars_;
+
+  // NOTE: the cycle of the wait-for graph, each front car waits for the road of the next.
+  if (!this->cycle_.empty()) {
+    std::cout << "Deadlock cycle: " << this->cycle_.size() << " cars\n";
+    for (auto e : this->cycle_) {
+      const RoadOnline &rd = this->roads_[e >> 1];
+      auto car_id        = cars.id[this->wait_for_[e].car];
+      auto goto_cross_id = (0 == (e & 1)) ? rd.get_to() : rd.get_from();
+      this->deadlock_cross_id_.push_back(goto_cross_id);
+      this->waiting_cars_id_.push_back(car_id);
+      this->overload_road_id_.push_back(rd.get_id());
+      std::cout << "#Car: " << car_id << ", "
+                << "#Goto_cross: " << goto_cross_id << ", "
+                << "#Current_road: " << rd.get_id() << ".\n";
+    }
+    return;
+  }
+
+  int sz = cars.size();
+  for (auto i = 0; i < sz; ++i) {
+    // NOTE: a car in its garage is WAIT too, but on no road yet.
+    if (WAIT != cars.state[i] || cars.channel[i] < 0) {
       continue;
     }
-    auto car_id = cr.get_id();
-    auto road_id = cr.get_current_road_id();
-    auto goto_cross_id = cr.get_current_road_goto_id();
+    const RoadOnline *rd = cars.hop_road_online(i, cars.hop[i]);
+    auto dir = cars.hop_dir(i, cars.hop[i]);
+    auto car_id = cars.id[i];
+    auto road_id = rd->get_id();
+    auto goto_cross_id = (0 == dir) ? rd->get_to() : ((1 == dir) ? rd->get_from() : -1);
     this->deadlock_cross_id_.push_back(goto_cross_id);
     this->waiting_cars_id_.push_back(car_id);
     this->overload_road_id_.push_back(road_id);
@@ -285,3 +837,127 @@ Judge::deadlock_info()
 
   return;
 }
+
+void
+Judge::record_delay(const int current_time)
+{
+  int sz = this->cars_.size();
+  if (this->last_road_idx_.empty()) {
+    this->last_road_idx_.assign(sz, -1);
+    this->enter_time_.assign(sz, 0);
+    this->passages_.resize(this->network_.edge_size());
+  }
+
+  const CarTable &cars = this->cars_;
+  for (auto i = 0; i < sz; ++i) {
+    int n = cars.path_size[i];
+    int cur;
+    if (FINISH == cars.state[i]) {
+      cur = n;
+    } else if (cars.channel[i] >= 0) {
+      cur = cars.hop[i];
+    } else {
+      continue; // not departed yet.
+    }
+
+    int last = this->last_road_idx_[i];
+    if (cur == last) {
+      continue;
+    }
+    if (last >= 0 && last < n) {
+      int r = cars.hop_road(i, last);
+      const RoadOnline *rd = &this->roads_[r];
+      int e = 2 * r + ((1 == cars.hop_dir(i, last)) ? 1 : 0);
+      int v = std::min(cars.speed[i], rd->get_speed());
+      this->passages_[e].push_back(Passage{ this->enter_time_[i], current_time - this->enter_time_[i], (rd->get_length() + v - 1) / v });
+    }
+    this->last_road_idx_[i] = cur;
+    this->enter_time_[i]    = current_time;
+  }
+  return;
+}
+
+void
+Judge::write_delay_table(const std::string &path,
+                         const int bucket)
+{
+  std::vector<std::vector<int>> table;
+  int sz = this->passages_.size();
+  for (auto e = 0; e < sz; ++e) {
+    if (this->passages_[e].empty()) {
+      continue;
+    }
+    // bucket start --> (count, delay, free)
+    std::map<int, std::vector<int>> rows;
+    for (auto &p : this->passages_[e]) {
+      std::vector<int> &row = rows[p.enter / bucket * bucket];
+      if (row.empty()) {
+        row.assign(3, 0);
+      }
+      ++row[0];
+      row[1] += p.delay;
+      row[2] += p.free;
+    }
+
+    const RawRoad &rd = this->network_.road(e >> 1);
+    int from = (e & 1) ? rd.to : rd.from;
+    for (auto &kv : rows) {
+      table.push_back(std::vector<int> { rd.id, from, kv.first, bucket, kv.second[0], kv.second[1], kv.second[2] });
+    }
+  }
+  write_to_file(path, table);
+  return;
+}
+
+void
+Judge::record_occupancy(const int current_time)
+{
+  if (this->occupancy_.empty()) {
+    this->occupancy_.resize(this->network_.edge_size());
+  }
+
+  int sz = this->roads_.size();
+  for (auto r = 0; r < sz; ++r) {
+    RoadOnline &rd = this->roads_[r];
+    int n = rd.get_num_of_running_cars(0);
+    if (n > 0) {
+      this->occupancy_[2 * r].push_back(std::make_pair(current_time, n));
+    }
+    if (1 == rd.get_duplex() && (n = rd.get_num_of_running_cars(1)) > 0) {
+      this->occupancy_[2 * r + 1].push_back(std::make_pair(current_time, n));
+    }
+  }
+  return;
+}
+
+std::vector<std::vector<int>>
+Judge::occupancy_table()
+  const
+{
+  std::vector<std::vector<int>> table;
+  int sz = this->occupancy_.size();
+  for (auto e = 0; e < sz; ++e) {
+    const RawRoad &rd = this->network_.road(e >> 1);
+    int from = (e & 1) ? rd.to : rd.from;
+    for (auto &p : this->occupancy_[e]) {
+      table.push_back(std::vector<int> { rd.id, from, p.first, p.second });
+    }
+  }
+  return table;
+}
+
+void
+Judge::record_wait_stats(const int current_time)
+{
+  const WaitStats &ws = this->wait_stats_;
+  this->wait_stats_rows_.push_back(std::vector<int> {
+      current_time, ws.sweeps, ws.visits, ws.serial_visits, ws.critical_visits, ws.stalls, (int) ws.usec });
+  return;
+}
+
+void
+Judge::write_wait_stats(const std::string &path)
+{
+  write_to_file(path, this->wait_stats_rows_);
+  return;
+}
@@ -11,49 +11,193 @@
 #include <algorithm>
 #include <vector>
 #include <string>
-
-#include <unordered_map>
-#include <utility>
-#include <map>
+#include <queue>      // std::priority_queue
+#include <functional> // std::greater
+#include <memory>     // std::unique_ptr
+#include <mutex>
+#include <atomic>
 
 #include "traffic.hpp"
-#include "../io.hpp"
+#include "../network.hpp"
+#include "../parallel.hpp"
 
 class Judge {
 public:
   // TODO: process input data.
-  Judge(std::string car_path, std::string road_path, std::string cross_path, std::string preset_path, std::string answer_path);
+  //   -- an empty `answer_path` runs the preset cars alone.
+  Judge(std::string car_path, std::string road_path, std::string cross_path, std::string preset_path, std::string answer_path, const bool renumber = false);
 
+  // NOTE: phase one moves cars within their own road only, so the roads are
+  //       split over `set_threads()` workers; the states are the same as serial.
   void drive_just_current_road();
   void drive_car_init_list(const int current_time, const bool is_priority);
+  // NOTE: create_car_sequence() also fills the first sweep of drive_car_in_wait_state().
   void create_car_sequence();
   bool drive_car_in_wait_state(const int current_time);
   bool is_finish();
 
   int get_all_schedule_time();
 
+  // NOTE: the next tick worth a step after `current_time`: the next one while a
+  //       car is on the road, else the earliest start time of a car still in
+  //       its garage (nothing happens in between). -1 if no car is left.
+  int next_time(const int current_time);
+
+  // NOTE: one tick of the schedule, false on deadlock.
+  bool step(const int current_time);
+
+  // NOTE: route a non-preset car while scheduling, `row` as a line of the answer
+  //       (car id, start time, road id, ...), before the step of the start time.
+  //       false (and the car is not counted) if the line has no road.
+  bool add_car_path(const std::vector<int> &row);
+
+  // NOTE: cars on the directed road (2 * road index + dir) now.
+  int get_num_of_running_cars(const int e) const;
+
+  // NOTE: the cycle of cars, roads and crosses if the wait-for graph closed one,
+  //       else every car waiting on a road.
   void deadlock_info();
 
+  // NOTE: workers of drive_just_current_road() and of the wait phase, one
+  //       region of crosses each, 1 (default) runs both serially.
+  void set_threads(const int threads);
+
+  // cross visits of the wait phase per tick, rows (tick, sweeps, visits, visits
+  // in serial sweeps, visits on the critical path, stalls at region borders, usec).
+  void record_wait_stats(const int current_time);
+  void write_wait_stats(const std::string &path);
+
+  // observed traversal delay (exit tick - entry tick) per directed road and entry bucket.
+  void record_delay(const int current_time);
+  void write_delay_table(const std::string &path, const int bucket);
+
+  // cars on each directed road per tick, rows as OCCUPANCY_* in network.hpp.
+  void record_occupancy(const int current_time);
+  std::vector<std::vector<int>> occupancy_table() const;
+
 private:
   Judge() = default;
 
-  void init_car_road_cross(const std::string car_path, const std::string road_path, const std::string cross_path);
-  void init_preset_and_answer_path(const std::string preset_path, const std::string answer_path);
+  void init_car_road_cross();
+  void init_preset_and_answer_path(const std::string answer_path);
 
   void init_cars_path(std::vector<std::vector<int>> &schedule, const int b_preset);
+  int  init_car_path(const std::vector<int> &v, const int b_preset);
+
+  // the shared road network, id -> dense index in O(1).
+  Network network_;
 
-  // sort cross by id ascending. and each road id ascending.
+  // same order as network_ (id ascending unless renumbered). and each road id ascending.
   std::vector<Cross>      crosses_;
   std::vector<RoadOnline> roads_;
-  std::vector<RunningCar> cars_;
-
-  // map id -> pointer
-  std::unordered_map<int, RunningCar*> m_id_to_pcar_;
-  std::unordered_map<int, RoadOnline*> m_id_to_proad_;
-  std::unordered_map<int, Cross*>      m_id_to_pcross_;
-
-  // map (road1, road2) --> cross
-  std::map<std::pair<RoadOnline*, RoadOnline*>, Cross*> m_pair_proads_to_pcross_;
+  CarTable                cars_;
+
+  // per road index, the cars in its garages or on its lanes. 0 for an idle road,
+  // which the passes of a tick skip.
+  std::vector<int>        road_occupancy_;
+
+  // scratch of init_car_path, the hops of one route.
+  std::vector<int>        route_;
+
+  // start times of the routed cars, the passed ones are popped by next_time().
+  std::priority_queue<int, std::vector<int>, std::greater<int>> departure_;
+
+  // phase one workers, and road index bounds of their chunks (size workers + 1),
+  // balanced by the cars on the road each tick.
+  std::unique_ptr<WorkerPool> pool_;
+  std::vector<int>            chunk_;
+  std::vector<long long>      road_load_;
+
+  // cross index in id ascending, the order crosses are scheduled in.
+  std::vector<int>        cross_order_;
+
+  // NOTE: worklist of the wait phase. a cross only changes when a road at it
+  //       does, so a sweep visits the crosses touched since their last visit,
+  //       in `cross_order_`, and a cross touched behind the current one waits
+  //       for the next sweep, as a full sweep would have it.
+  //   -- order_pos_: cross index -> position in cross_order_.
+  typedef std::priority_queue<int, std::vector<int>, std::greater<int>> Sweep;
+  std::vector<int>  order_pos_;
+  std::vector<char> in_sweep_, in_next_sweep_;
+  int               num_of_wait_car_;
+
+  // NOTE: regions of the wait phase, one per worker (a single one if serial).
+  //   a cross reads and writes only the roads at it, so the sweep orders two
+  //   crosses only if they share a road. a region walks its own crosses in
+  //   sweep order, and before passing a `late` cross (one with a neighbour of a
+  //   lower position in another region) waits until that region has passed the
+  //   neighbour. a touch across regions goes to the inbox of the touched
+  //   region. so the state of a tick is the serial one.
+  struct Region {
+    Region() : progress(-1), wait_delta(0), visits(0), stalls(0) {}
+
+    Sweep                             sweep, next;
+    // late crosses (position ascending), late[i] waits for need[need_begin[i], need_begin[i + 1]),
+    // as (region, position) to be passed first.
+    std::vector<int>                  late;
+    std::vector<int>                  need_begin;
+    std::vector<std::pair<int, int>>  need;
+    // touches from the other regions, (position, 1 if in this sweep).
+    std::mutex                        inbox_mtx;
+    std::vector<std::pair<int, char>> inbox;
+    // every position of this region up to `progress` is done in this sweep.
+    std::atomic<int>                  progress;
+    int                               wait_delta, visits, stalls;
+    // directed roads blocked by the crosses of this region in this sweep.
+    std::vector<int>                  blocked;
+  };
+  std::vector<std::unique_ptr<Region>> regions_;
+  std::vector<int>                     region_of_; // position -> region
+
+  // NOTE: wait-for graph of the wait phase, by directed road (2 * road index + dir).
+  //   a road whose front waiting car found no slot on its next road waits for
+  //   that road, so each road waits for one at most. a link holds while neither
+  //   road was touched since (`road_version_`, bumped by touch_road) and no
+  //   priority car may depart into the next road, so the roads of a cycle of
+  //   links never move again: the deadlock, found after the sweep it forms in.
+  //   -- the walks of a check visit a road once, O(waiting roads).
+  struct WaitFor { int next, car, tick, version, next_version; };
+  std::vector<WaitFor> wait_for_;
+  std::vector<int>     road_version_; // road index -> touches in the wait phase
+  std::vector<int>     wait_walk_;    // directed road -> last walk through it
+  int                  walks_;
+  std::vector<int>     blocked_;      // blocked in the last sweep, all regions
+  std::vector<int>     cycle_;        // the directed roads of the deadlock, empty if none
+
+  void block_road(const int edge, const int car, const int pos, const int current_time);
+  bool is_waiting_for(const int edge, const int current_time) const;
+  bool find_wait_cycle(const int current_time);
+
+  void partition_regions(const int num);
+
+  // NOTE: `from_pos` is the position being resolved (-1 before the first sweep),
+  //       `from_region` its region while the regions run, else -1.
+  void touch_cross(const int cross_id, const int from_pos, const int from_region);
+  void touch_road(const RoadOnline *road, const int from_pos, const int from_region);
+  void push_sweep(const int region, const int pos, const bool in_this_sweep);
+  void drain_inbox(const int region);
+  void clear_next_sweep();
+
+  // one cross of the wait phase, returns the change of the waiting cars.
+  int  resolve_cross(const int pos, const int current_time, const int region);
+  int  sweep_serial(const int current_time);
+  int  sweep_regions(const int current_time);
+  void sweep_region(const int region, const int current_time);
+
+  struct WaitStats { int sweeps, visits, serial_visits, critical_visits, stalls; long long usec; };
+  WaitStats                     wait_stats_;
+  std::vector<std::vector<int>> wait_stats_rows_;
+
+  // delay table: car --> road idx on its path (-1 before departure) and its entry tick.
+  std::vector<int> last_road_idx_;
+  std::vector<int> enter_time_;
+
+  // directed road (2 * road index + dir) --> { (entry tick, delay, free-flow time), ... }
+  struct Passage { int enter, delay, free; };
+  std::vector<std::vector<Passage>> passages_;
+
+  // directed road --> { (tick, cars on it), ... }, ticks without car are skipped.
+  std::vector<std::vector<std::pair<int, int>>> occupancy_;
 
   // Deadlock info.
   std::vector<int> deadlock_cross_id_;
@@ -66,10 +210,21 @@ Judge::Judge(std::string car_path,
              std::string road_path,
              std::string cross_path,
              std::string preset_path,
-             std::string answer_path)
+             std::string answer_path,
+             const bool renumber)
+  : network_(car_path, road_path, cross_path, preset_path, renumber)
+{
+  this->init_car_road_cross();
+  this->num_of_wait_car_ = 0;
+  this->init_preset_and_answer_path(answer_path);
+}
+
+inline int
+Judge::get_num_of_running_cars(const int e)
+  const
 {
-  this->init_car_road_cross(car_path, road_path, cross_path);
-  this->init_preset_and_answer_path(preset_path, answer_path);
+  const RoadOnline &rd = this->roads_[e >> 1];
+  return rd.get_num_of_running_cars(e & 1);
 }
 
 #endif // ifndef _JUDGE_HPP_
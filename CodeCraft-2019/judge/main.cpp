@@ -21,26 +21,66 @@ int main(int argc, char *argv[])
   std::string presetAnswerPath (argv[4]);
   std::string answerPath       (argv[5]);
 
-  Judge scheduler(carPath, roadPath, crossPath, presetAnswerPath, answerPath);
+  // --renumber=1: renumber crosses and roads for locality, the result is unchanged.
+  // --delay-table=<path>: export the observed road delays, bucketed by
+  //                       --delay-bucket=<ticks> (default 50) of the entry tick.
+  // --threads=<n>: workers of the judge (default 1), one region of crosses each.
+  // --wait-stats=<path>: export the cross visits of the wait phase per tick.
+  bool renumber = false;
+  std::string delayPath, waitPath;
+  int delayBucket = 50;
+  int threads = 1;
+  for (int i = 6; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if (arg.compare(0, 11, "--renumber=") == 0) {
+      renumber = arg.substr(11) != "0";
+    } else if (arg.compare(0, 14, "--delay-table=") == 0) {
+      delayPath = arg.substr(14);
+    } else if (arg.compare(0, 15, "--delay-bucket=") == 0) {
+      delayBucket = std::max(1, std::stoi(arg.substr(15)));
+    } else if (arg.compare(0, 10, "--threads=") == 0) {
+      threads = std::max(1, std::stoi(arg.substr(10)));
+    } else if (arg.compare(0, 13, "--wait-stats=") == 0) {
+      waitPath = arg.substr(13);
+    }
+  }
+
+  Judge scheduler(carPath, roadPath, crossPath, presetAnswerPath, answerPath, renumber);
+  scheduler.set_threads(threads);
 
+  // NOTE: idle ticks (no car on the road) are skipped to the next departure.
   int timer = 0;
   while (true) {
-    ++timer;
+    int next = scheduler.next_time(timer);
+    timer = (next < 0) ? timer + 1 : next;
     std::cout << "\rTime: " << timer;
 
-    scheduler.drive_just_current_road();
-    scheduler.drive_car_init_list(timer, true);
-    scheduler.create_car_sequence();
-
-    if (!scheduler.drive_car_in_wait_state(timer)) {
+    if (!scheduler.step(timer)) {
       // XXX: deadlock
       std::cout << "\nTime: " << timer <<  ", Deadlock!\n" << std::endl;
       scheduler.deadlock_info();
+      if (!delayPath.empty()) {
+        scheduler.write_delay_table(delayPath, delayBucket);
+      }
+      if (!waitPath.empty()) {
+        scheduler.write_wait_stats(waitPath);
+      }
       return -1;
     }
 
-    scheduler.drive_car_init_list(timer, false);
+    if (!delayPath.empty()) {
+      scheduler.record_delay(timer);
+    }
+    if (!waitPath.empty()) {
+      scheduler.record_wait_stats(timer);
+    }
     if (scheduler.is_finish()) {
+      if (!delayPath.empty()) {
+        scheduler.write_delay_table(delayPath, delayBucket);
+      }
+      if (!waitPath.empty()) {
+        scheduler.write_wait_stats(waitPath);
+      }
       // XXX: all cars finished.
       std::cout << "\nOriginal Result: schedule time = " << timer << ", " 
                 << "all schedule time = " << scheduler.get_all_schedule_time()
@@ -8,102 +8,79 @@
 #include <iostream> // DEBUG
 #include "traffic.hpp"
 
-/*{{{ compare_priority... */
-bool
-compare_priority_for_init_list(RunningCar* const &c1,
-                               RunningCar* const &c2)
-{
-  return c1->get_priority()  > c2->get_priority() ||
-        (c1->get_priority() == c2->get_priority() && c1->get_start_time()  < c2->get_start_time()) ||
-        (c1->get_priority() == c2->get_priority() && c1->get_start_time() == c2->get_start_time() && c1->get_id() < c2->get_id());
-}
-
-bool
-compare_priority_for_waiting_cars(RunningCar* const &c1,
-                                  RunningCar* const &c2)
-{
-  return (c1->get_current_road_channel() == c2->get_current_road_channel() && c1->get_current_road_pos() > c2->get_current_road_pos()) ||
-         (c1->get_current_road_channel() != c2->get_current_road_channel() && c1->get_priority() > c2->get_priority()) ||
-         (c1->get_current_road_channel() < c2->get_current_road_channel() && c1->get_priority() == c2->get_priority());
-}
-/*}}}*/
-
 void
-RunningCar::init(const int start_time,
-                 std::vector<RoadOnline*> &p,
-                 std::map<std::pair<RoadOnline*, RoadOnline*>, Cross*> &m,
-                 std::unordered_map<int, Cross*> &cs_id_to_pcs)
+CarTable::init(const int car,
+               const int start,
+               const int *first,  // IN: the hops, edge index or ~(2 * road).
+               const int *last)
 {
-  this->start_time_                       = start_time;
-  this->end_time_                         = start_time - this->plan_time_;
-  this->path_.assign(p.begin(), p.end());
-
-  this->idx_of_current_road_              = 1;
-  this->current_road_pos_                 = 0;
-  this->next_road_pos_                    = 0;
-  this->current_road_channel_             = -1;
-  this->state_                            = WAIT;
-
-  // initiating start_cross_id_sequence_
-  this->start_cross_id_sequence_.push_back(cs_id_to_pcs[this->from_]);
-  auto sz = this->path_.size();
-  for (auto i = 1; i < sz; ++i) {
-    this->start_cross_id_sequence_.push_back(m[{ this->path_[i - 1], this->path_[i] }]);
-  }
+  this->start_time[car]                   = start;
+  this->end_time[car]                     = start - this->plan_time[car];
+  this->path_begin[car]                   = this->path_arena.size();
+  this->path_size[car]                    = last - first;
+  this->path_arena.insert(this->path_arena.end(), first, last);
+
+  this->hop[car]                          = 1;
+  this->pos[car]                          = 0;
+  this->next_pos[car]                     = 0;
+  this->channel[car]                      = -1;
+  this->state[car]                        = WAIT;
+
+  ++(this->census.routed);
   return;
 }
 
 bool
-RunningCar::move_to_next_road() // for waiting car. XXX: require updateing!!!
+CarTable::move_to_next_road(const int car) // for waiting car. XXX: require updateing!!!
 {
-  if (FINISH == this->state_) {
-    auto current_start_cross_id = this->start_cross_id_sequence_[this->idx_of_current_road_]->get_id();
-    this->path_.back()->remove_car(this->current_road_channel_, current_start_cross_id, this);
+  int h = this->hop[car];
+  RoadOnline *road = this->hop_road_online(car, h);
+
+  if (FINISH == this->state[car]) {
+    road->remove_car(this->channel[car], this->hop_dir(car, h), car);
     return true;
   }
 
-  if (FINAL == this->state_) {
+  if (FINAL == this->state[car]) {
     return false;
   }
 
-  auto next_road_idx         = this->idx_of_current_road_ + 1;
-  if (next_road_idx >= this->path_.size()) {
-    this->state_                = FINISH; // XXX: perhaps exist some errors.
-    auto current_start_cross_id = this->start_cross_id_sequence_[this->idx_of_current_road_]->get_id();
-    this->path_.back()->remove_car(this->current_road_channel_, current_start_cross_id, this);
+  auto next_road_idx = h + 1;
+  if (next_road_idx >= this->path_size[car]) {
+    this->state[car] = FINISH; // XXX: perhaps exist some errors.
+    road->remove_car(this->channel[car], this->hop_dir(car, h), car);
 
-    ++(this->end_time_);
+    ++(this->end_time[car]);
+    this->count_finish(car);
     return true;
   }
 
-  auto next_road_start_cross = this->start_cross_id_sequence_[next_road_idx]->get_id();
-  auto next_road = this->path_[next_road_idx];
+  auto next_dir  = this->hop_dir(car, next_road_idx);
+  auto next_road = this->hop_road_online(car, next_road_idx);
 
-  if (next_road->is_final_filled(next_road_start_cross)) {
-    this->current_road_pos_ = this->path_[this->idx_of_current_road_]->get_length();
-    this->state_            = FINAL;
+  if (next_road->is_final_filled(next_dir)) {
+    this->pos[car]   = road->get_length();
+    this->state[car] = FINAL;
 
-    ++(this->end_time_);
+    ++(this->end_time[car]);
     return true;
   }
 
-  auto next_road_channel_and_pos = next_road->select_valid_channel(next_road_start_cross);
+  auto next_road_channel_and_pos = next_road->select_valid_channel(next_dir);
   auto next_channel              = next_road_channel_and_pos.first;
   auto next_pos                  = next_road_channel_and_pos.second;
 
   if (next_channel >= 0) {
-    auto current_start_cross_id = this->start_cross_id_sequence_[this->idx_of_current_road_]->get_id();
-    this->path_[this->idx_of_current_road_]->remove_car(this->current_road_channel_, current_start_cross_id, this);
-
-    ++(this->idx_of_current_road_);
-    this->current_road_channel_ = next_channel;
-    this->current_road_pos_     = std::min(this->next_road_pos_, next_pos);
-    this->next_road_pos_        = 0;
-    this->state_                = FINAL;
-
-    auto next_start_cross_id = this->start_cross_id_sequence_[this->idx_of_current_road_]->get_id();
-    this->path_[this->idx_of_current_road_]->push_back_car(this->current_road_channel_, next_start_cross_id, this);
-    ++(this->end_time_);
+    road->remove_car(this->channel[car], this->hop_dir(car, h), car);
+
+    this->hop[car]      = next_road_idx;
+    this->channel[car]  = next_channel;
+    this->pos[car]      = std::min(this->next_pos[car], next_pos);
+    this->next_pos[car] = 0;
+    this->state[car]    = FINAL;
+
+    next_road->push_back_car(next_channel, next_dir, car);
+    ++(this->end_time[car]);
     return true;
   }
 
@@ -111,79 +88,57 @@ RunningCar::move_to_next_road() // for waiting car. XXX: require updateing!!!
 }
 
 void
-RunningCar::drive(const int speed)
+CarTable::drive(const int car,
+                const int sp)
 {
-  int current_road_len = this->path_[this->idx_of_current_road_]->get_length();
-  if (this->current_road_pos_ + speed <= current_road_len) {
-    this->current_road_pos_ += speed;
-    this->state_             = FINAL;
+  int h = this->hop[car];
+  RoadOnline *road = this->hop_road_online(car, h);
 
-    ++(this->end_time_);
-    return;
-  }
-
-  if (this->path_.size() - 1 <= this->idx_of_current_road_) {
-    this->current_road_pos_  = this->path_.back()->get_length() + 1;
-    this->state_             = FINISH;
-
-    auto channel = this->current_road_channel_;
-    auto start_cross_id = this->start_cross_id_sequence_.back()->get_id();
-    this->path_.back()->remove_car(channel, start_cross_id, this);
+  int current_road_len = road->get_length();
+  if (this->pos[car] + sp <= current_road_len) {
+    this->pos[car]  += sp;
+    this->state[car] = FINAL;
 
-    ++(this->end_time_);
+    ++(this->end_time[car]);
     return;
   }
 
-  int s1 = current_road_len - this->current_road_pos_;
-  RoadOnline *next_road = this->path_[this->idx_of_current_road_ + 1];
-  int v2 = std::min(this->speed_, next_road->get_speed());
+  if (this->path_size[car] - 1 <= h) {
+    this->pos[car]   = current_road_len + 1;
+    this->state[car] = FINISH;
 
-  this->current_road_pos_ = current_road_len;
-  this->next_road_pos_    = std::max(0, v2 - s1);
-  this->state_            = ((this->next_road_pos_ <= 0) ? FINAL : WAIT);
+    road->remove_car(this->channel[car], this->hop_dir(car, h), car);
 
-  if (FINAL == this->state_) {
-    ++(this->end_time_);
+    ++(this->end_time[car]);
+    this->count_finish(car);
+    return;
   }
 
-  return;
-}
+  int s1 = current_road_len - this->pos[car];
+  RoadOnline *next_road = this->hop_road_online(car, h + 1);
+  int v2 = std::min(this->speed[car], next_road->get_speed());
 
+  this->pos[car]      = current_road_len;
+  this->next_pos[car] = std::max(0, v2 - s1);
+  this->state[car]    = ((this->next_pos[car] <= 0) ? FINAL : WAIT);
 
-void
-RoadInitCarList::create_car_sequence_for_ready_car()
-{
-  dir_cars_.sort(compare_priority_for_init_list);
-  if (1 == this->is_duplex_) {
-    inv_cars_.sort(compare_priority_for_init_list);
+  if (FINAL == this->state[car]) {
+    ++(this->end_time[car]);
   }
-  return;
-}
 
-void
-RoadOnline::drive_just_current_road(const int channel,
-                                    const int start_cross_id,
-                                    const bool for_wait_car)
-{
-  if (start_cross_id == this->from_) {
-    this->drive_just_current_road(channel, this->dir_on_running_cars_ls_, for_wait_car);
-  }
-  else if (start_cross_id == this->to_) {
-    this->drive_just_current_road(channel, this->inv_on_running_cars_ls_, for_wait_car);
-  }
   return;
 }
 
 void
 RoadOnline::drive_just_current_road()
 {
-  for (auto i = 0; i < this->channel_; ++i) {
-    drive_just_current_road(i, this->from_, false);
-  }
-
-  if (1 == this->is_duplex_) {
-    for (auto i = 0; i < this->channel_; ++i) {
-      drive_just_current_road(i, this->to_, false);
+  for (auto d = 0; d < 2; ++d) {
+    if (0 == this->num_of_cars_[d]) {
+      continue;
+    }
+    int sz = this->lanes_[d].size();
+    for (auto i = 0; i < sz; ++i) {
+      drive_just_current_road(i, d, false);
     }
   }
   return;
@@ -191,72 +146,78 @@ RoadOnline::drive_just_current_road()
 
 void
 RoadOnline::drive_just_current_road(const int channel,
-                                    std::vector<std::list<RunningCar*>> &cars,
+                                    const int dir,
                                     const bool for_wait_car)
 {
-  if (channel < 0 || channel >= cars.size()) {
+  if (dir < 0 || dir > 1 || channel < 0 || channel >= (int) this->lanes_[dir].size()) {
     return;
   }
 
+  CarTable &cars = *this->cars_;
   int v = 0, prev_pos = this->length_ + 1;
   State prev_state = WAIT;
-  for (auto c : cars[channel]) {
-    if (for_wait_car && c->get_state() != WAIT) {
+  for (auto c : this->lanes_[dir][channel]) {
+    if (for_wait_car && cars.state[c] != WAIT) {
       // XXX: perhap some bugs.
-      prev_pos   = c->get_current_road_pos();
+      prev_pos   = cars.pos[c];
       prev_state = FINAL;
       continue;
     }
 
-    v = std::min(c->get_speed(), this->get_speed());
-    if (v >= prev_pos - c->get_current_road_pos()) {
+    v = std::min(cars.speed[c], this->get_speed());
+    if (v >= prev_pos - cars.pos[c]) {
       if (prev_state == FINAL) {
-        c->drive(prev_pos - c->get_current_road_pos() - 1);
+        cars.drive(c, prev_pos - cars.pos[c] - 1);
       }
       // XXX: must not exist state `finish`.
       if (prev_state == WAIT) {
-        c->set_state(WAIT);
+        cars.state[c] = WAIT;
       } else {
-        c->set_state(FINAL); // XXX: exists some bugs
+        cars.state[c] = FINAL; // XXX: exists some bugs
       }
     } else {
-      c->drive(v);
-      c->set_state(FINAL);
+      cars.drive(c, v);
+      cars.state[c] = FINAL;
     }
-    prev_pos   = c->get_current_road_pos();
-    prev_state = c->get_state();
+    prev_pos   = cars.pos[c];
+    prev_state = (State) cars.state[c];
   }
 
   return;
 }
 
 bool
-RoadOnline::run_to_road(RunningCar* c,
-                        std::vector<std::list<RunningCar*>> &running_cars)
+RoadOnline::run_to_road(const int car,
+                        const int dir)
 {
-  if (nullptr == c) return false;
+  if (car < 0) return false;
 
-  int v = std::min(c->get_speed(), this->get_speed());
+  CarTable &cars = *this->cars_;
+  std::vector<Lane> &running_cars = this->lanes_[dir];
+  int v = std::min(cars.speed[car], this->get_speed());
 
   int sz = running_cars.size();
   for (auto i = 0; i < sz; ++i) {
-    if (!running_cars[i].empty() && running_cars[i].back()->get_current_road_pos() <= 1) {
+    const Lane &lane = running_cars[i];
+    if (!lane.empty() && cars.pos[lane.back()] <= 1) {
       continue;
     }
 
-    if (!running_cars[i].empty() && running_cars[i].back()->get_current_road_pos() <= v && running_cars[i].back()->get_state() == WAIT) {
+    if (!lane.empty() && cars.pos[lane.back()] <= v && cars.state[lane.back()] == WAIT) {
       continue;
     }
 
-    if (!running_cars[i].empty()) {
-      v = std::min(v, running_cars[i].back()->get_current_road_pos() - 1);
+    if (!lane.empty()) {
+      v = std::min(v, cars.pos[lane.back()] - 1);
     }
 
-    c->set_current_road_pos(v);
-    c->set_state(FINAL);
-    c->set_current_road_idx(0);
-    c->set_current_road_channel(i);
-    running_cars[i].push_back(c);
+    cars.pos[car]     = v;
+    cars.state[car]   = FINAL;
+    cars.hop[car]     = 0;
+    cars.channel[car] = i;
+    running_cars[i].push_back(car);
+    ++(this->num_of_cars_[dir]);
+    cars.count_departure();
 
     return true;
   }
@@ -264,23 +225,61 @@ RoadOnline::run_to_road(RunningCar* c,
   return false;
 }
 
+bool
+RoadOnline::can_depart_priority(const int dir,
+                                const int current_time)
+  const
+{
+  const Garage &garage = this->garages_[dir];
+  if (!garage.pending_priority.empty() && garage.pending_priority.top().first <= current_time) {
+    return true; // not released yet, as if any could.
+  }
+  if (garage.ready_priority.empty()) {
+    return false;
+  }
+
+  // NOTE: the slowest car enters wherever another could.
+  const CarTable &cars = *this->cars_;
+  int v = this->get_speed();
+  for (auto c : garage.ready_priority) {
+    v = std::min(v, cars.speed[c]);
+  }
+  for (auto &lane : this->lanes_[dir]) {
+    if (lane.empty()) {
+      return true;
+    }
+    int back = lane.back();
+    if (cars.pos[back] > 1 && !(cars.pos[back] <= v && cars.state[back] == WAIT)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void
 RoadOnline::run_car_in_init_list(const int current_time,
                                  const bool is_priority,
-                                 std::list<RunningCar*> &init_list,
-                                 std::vector<std::list<RunningCar*>> &running_cars)
+                                 const int dir)
 {
-  for (auto it = init_list.begin(); it != init_list.end(); ) {
-    if (current_time < (*it)->get_start_time() ||
-        (is_priority && (*it)->get_priority() == 0)) {
-      ++it;
-      continue;
+  Garage &garage = this->garages_[dir];
+  garage.release(current_time);
+
+  auto &prio = garage.ready_priority;
+  if (is_priority) {
+    for (auto it = prio.begin(); it != prio.end(); ) {
+      it = run_to_road(*it, dir) ? prio.erase(it) : std::next(it);
     }
+    return;
+  }
 
-    if (run_to_road(*it, running_cars)) {
-      it = init_list.erase(it);
+  // NOTE: all ready cars in id order, the two queues merged.
+  auto &rest = garage.ready;
+  auto p = prio.begin(), q = rest.begin();
+  while (p != prio.end() || q != rest.end()) {
+    if (q == rest.end() || (p != prio.end() && *p < *q)) {
+      p = run_to_road(*p, dir) ? prio.erase(p) : std::next(p);
     } else {
-      ++it;
+      q = run_to_road(*q, dir) ? rest.erase(q) : std::next(q);
     }
   }
   return;
@@ -290,64 +289,50 @@ void
 RoadOnline::run_car_in_init_list(const int current_time,
                                  const bool is_priority)
 {
-  run_car_in_init_list(current_time, is_priority, this->dir_cars_, this->dir_on_running_cars_ls_);
+  run_car_in_init_list(current_time, is_priority, 0);
   if (1 == this->is_duplex_) {
-    run_car_in_init_list(current_time, is_priority, this->inv_cars_, this->inv_on_running_cars_ls_);
+    run_car_in_init_list(current_time, is_priority, 1);
   }
   return;
 }
 
 bool
-RoadOnline::is_final_filled(const int start_cross_id)
+RoadOnline::is_final_filled(const int dir)
+  const
 {
-  if (start_cross_id == this->from_) {
-    for (auto &channel : this->dir_on_running_cars_ls_) {
-      if (channel.size() <= 0) {
-        return false;
-      }
-      if (channel.back()->get_state() != FINAL || channel.back()->get_current_road_pos() > 1) {
-        return false;
-      }
-    }
+  if (dir < 0 || dir > 1) {
+    return true;
   }
-  else if (1 == this->is_duplex_ && start_cross_id == this->to_) {
-    for (auto &channel : this->inv_on_running_cars_ls_) {
-      if (channel.size() <= 0) {
-        return false;
-      }
-      if (channel.back()->get_state() != FINAL || channel.back()->get_current_road_pos() > 1) {
-        return false;
-      }
+
+  const CarTable &cars = *this->cars_;
+  for (auto &channel : this->lanes_[dir]) {
+    if (channel.size() <= 0) {
+      return false;
+    }
+    if (cars.state[channel.back()] != FINAL || cars.pos[channel.back()] > 1) {
+      return false;
     }
   }
   return true;
 }
 
 std::pair<int, int>
-RoadOnline::select_valid_channel(const int start_cross_id)
+RoadOnline::select_valid_channel(const int dir)
+  const
 {
-  if (start_cross_id == this->from_) {
-    auto sz = this->dir_on_running_cars_ls_.size();
-    for (auto i = 0; i < sz; ++i) {
-      if (this->dir_on_running_cars_ls_[i].size() == 0) {
-        return { i, this->length_ };
-      }
-      else if (this->dir_on_running_cars_ls_[i].back()->get_current_road_pos() > 1 &&
-               this->dir_on_running_cars_ls_[i].back()->get_state() != WAIT) {
-        return { i, this->dir_on_running_cars_ls_[i].back()->get_current_road_pos() - 1 };
-      }
-    }
+  if (dir < 0 || dir > 1) {
+    return { -1, 0 };
   }
-  else if (1 == this->is_duplex_ && start_cross_id == this->to_) {
-    auto sz = this->inv_on_running_cars_ls_.size();
-    for (auto i = 0; i < sz; ++i) {
-      if (this->inv_on_running_cars_ls_[i].size() == 0) {
-        return { i, this->length_ };
-      }
-      else if (this->inv_on_running_cars_ls_[i].back()->get_current_road_pos() > 1 &&
-               this->inv_on_running_cars_ls_[i].back()->get_state() != WAIT) {
-        return { i, this->inv_on_running_cars_ls_[i].back()->get_current_road_pos() - 1 };
-      }
+
+  const CarTable &cars = *this->cars_;
+  const std::vector<Lane> &lanes = this->lanes_[dir];
+  int sz = lanes.size();
+  for (auto i = 0; i < sz; ++i) {
+    if (lanes[i].size() == 0) {
+      return { i, this->length_ };
+    }
+    else if (cars.pos[lanes[i].back()] > 1 && cars.state[lanes[i].back()] != WAIT) {
+      return { i, cars.pos[lanes[i].back()] - 1 };
     }
   }
 
@@ -356,86 +341,94 @@ RoadOnline::select_valid_channel(const int start_cross_id)
 
 void
 RoadOnline::remove_car(const int channel,
-                       const int start_cross_id,
-                       RunningCar* const car)
+                       const int dir,
+                       const int car)
 {
-  if (channel < 0 || channel >= this->channel_) {
+  if (dir < 0 || dir > 1 || channel < 0 || channel >= (int) this->lanes_[dir].size()) {
     return;
   }
 
-  if (start_cross_id == this->from_) {
-    this->dir_on_running_cars_ls_[channel].remove(car);
-  }
-  else if (start_cross_id == this->to_) {
-    this->inv_on_running_cars_ls_[channel].remove(car);
-  }
-
+  Lane &lane = this->lanes_[dir][channel];
+  int before = lane.size();
+  lane.remove(car);
+  this->num_of_cars_[dir] -= before - lane.size();
+  *this->occupancy_      -= before - lane.size();
   return;
 }
 
 void
 RoadOnline::push_back_car(const int channel,
-                          const int start_cross_id,
-                          RunningCar* const car)
+                          const int dir,
+                          const int car)
 {
-  if (channel < 0 || channel >= this->channel_) {
+  if (dir < 0 || dir > 1 || channel < 0 || channel >= (int) this->lanes_[dir].size()) {
     return;
   }
 
-  if (start_cross_id == this->from_) {
-    this->dir_on_running_cars_ls_[channel].push_back(car);
-  }
-  else if (start_cross_id == this->to_) {
-    this->inv_on_running_cars_ls_[channel].push_back(car);
-  }
-
+  this->lanes_[dir][channel].push_back(car);
+  ++(this->num_of_cars_[dir]);
+  ++(*this->occupancy_);
   return;
 }
 
 void
 RoadOnline::create_car_in_wait_sequence()
 {
-  this->dir_on_waiting_cars_ls_.clear();
-  this->inv_on_waiting_cars_ls_.clear();
-
-  for (auto &ls : this->dir_on_running_cars_ls_) {
-    for (auto c : ls) {
-      if (WAIT == c->get_state()) {
-        this->dir_on_waiting_cars_ls_.push_back(c);
-      }
+  for (auto d = 0; d < 2; ++d) {
+    this->num_of_wait_[d] = 0;
+    if (0 == this->num_of_cars_[d]) {
+      continue; // the prefixes of empty lanes are 0 already.
+    }
+    int sz = this->lanes_[d].size();
+    for (auto i = 0; i < sz; ++i) {
+      this->wait_prefix_[d][i] = this->count_wait_prefix(this->lanes_[d][i]);
+      this->num_of_wait_[d]   += this->wait_prefix_[d][i];
     }
   }
 
-  if (!this->dir_on_waiting_cars_ls_.empty()) {
-    this->dir_on_waiting_cars_ls_.sort(compare_priority_for_waiting_cars);
-  }
-
-  if (1 == this->is_duplex_) {
-    for (auto &ls : this->inv_on_running_cars_ls_) {
-      for (auto c : ls) {
-        if (WAIT == c->get_state()) {
-          this->inv_on_waiting_cars_ls_.push_back(c);
-        }
-      }
-    }
+  return;
+}
 
-    if (!this->inv_on_waiting_cars_ls_.empty()) {
-      this->inv_on_waiting_cars_ls_.sort(compare_priority_for_waiting_cars);
-    }
+void
+RoadOnline::update_wait_sequence(const int channel,
+                                 const int dir)
+{
+  if (dir < 0 || dir > 1 || channel < 0 || channel >= (int) this->lanes_[dir].size()) {
+    return;
   }
 
+  int n = this->count_wait_prefix(this->lanes_[dir][channel]);
+  this->num_of_wait_[dir]          += n - this->wait_prefix_[dir][channel];
+  this->wait_prefix_[dir][channel]  = n;
+
   return;
 }
 
-RunningCar*
-RoadOnline::get_front_car_from_wait_sequence(const int start_cross_id)
+int
+RoadOnline::get_front_car_from_wait_sequence(const int dir)
+  const
 {
-  if (start_cross_id == this->from_) {
-    return this->dir_on_waiting_cars_ls_.front();
-  }
-  else if (start_cross_id == this->to_) {
-    return this->inv_on_waiting_cars_ls_.front();
+  if (dir < 0 || dir > 1 || this->num_of_wait_[dir] <= 0) {
+    return -1;
   }
 
-  return nullptr;
+  // NOTE: key = (priority, position, -channel), all small integers.
+  const CarTable &cars = *this->cars_;
+  const std::vector<Lane> &lanes = this->lanes_[dir];
+  const std::vector<int>  &wait_prefix = this->wait_prefix_[dir];
+  int ret = -1;
+  long long best = -1;
+  int sz = lanes.size();
+  for (auto i = 0; i < sz; ++i) {
+    if (wait_prefix[i] <= 0) {
+      continue;
+    }
+    int c = lanes[i].front();
+    long long key = ((long long) cars.priority[c] * (this->length_ + 2) + cars.pos[c]) * (sz + 1) + (sz - i);
+    if (key > best) {
+      best = key;
+      ret  = c;
+    }
+  }
+  return ret;
 }
@@ -11,57 +11,15 @@
 #include <iostream> // DEBUG
 
 #include <vector>
-#include <list>
 #include <utility> // std::pair
-#include <unordered_map>
-#include <map>
+#include <iterator> // std::next
 #include <algorithm>
+#include <atomic>
+#include <set>
+#include <queue>      // std::priority_queue
+#include <functional> // std::greater
 #include "common.hpp"
 
-/*{{{ class Car: id, from, to, speed, plan_time, priority, preset */
-class Car : public StartEnd {
-public:
-  Car(int i, int from, int to, int speed, int plan_time, int priority, int preset)
-    : StartEnd(i, speed, from, to)
-    , plan_time_(plan_time)
-    , priority_(priority)
-    , preset_(preset) {}
-
-  int get_plan_time() const;
-  int get_priority()  const;
-  int get_preset()    const;
-
-protected:
-  int plan_time_;
-  int  priority_;
-  int    preset_;
-
-private:
-  Car() = default;
-};
-
-inline int
-Car::get_plan_time()
-  const
-{
-  return this->plan_time_;
-}
-
-inline int
-Car::get_priority()
-  const
-{
-  return this->priority_;
-}
-
-inline int
-Car::get_preset()
-  const
-{
-  return this->preset_;
-}
-/*}}}*/
-
 /*{{{ class Road: id, length, speed, channel, from, to, is_duplex */
 class Road : public StartEnd {
 public:
@@ -106,8 +64,8 @@ public:
       std::sort(this->roads_id_.begin(), this->roads_id_.end());
     }
 
-  std::vector<RoadOnline*> get_roads();
-  void init(std::unordered_map<int, RoadOnline*> &road_id_to_roadonline);
+  const std::vector<RoadOnline*>& get_roads() const;
+  void init(const std::vector<RoadOnline*> &roads_online);
 
 protected:
   std::vector<int> roads_id_;
@@ -117,256 +75,479 @@ private:
   Cross() = default;
 };
 
-inline std::vector<RoadOnline*>
+inline const std::vector<RoadOnline*>&
 Cross::get_roads()
+  const
 {
   return this->roads_online_;
 }
 
 inline void
-Cross::init(std::unordered_map<int, RoadOnline*> &road_id_to_roadonline)
+Cross::init(const std::vector<RoadOnline*> &roads_online) // IN: road id ascending.
 {
-  for (auto id : this->roads_id_) {
-    if (id == -1) {
-      continue;
-    }
-    this->roads_online_.push_back(road_id_to_roadonline[id]);
-  }
+  this->roads_online_.assign(roads_online.begin(), roads_online.end());
   return;
 }
 /*}}}*/
 
-/*{{{ class RunningCar*/
+/*{{{ struct Census: live counts of the routed cars */
+// NOTE: kept by the cars as they are routed, depart and finish, so the judge
+//       knows how many are in garages (routed - departed), on the road
+//       (departed - finished) and the total schedule time without a scan.
+//   -- atomic, the regions of the wait phase may count at once.
+struct Census {
+  Census() : routed(0), departed(0), finished(0), end_time_sum(0) {}
+  std::atomic<int>       routed, departed, finished;
+  std::atomic<long long> end_time_sum;
+};
+/*}}}*/
+
+/*{{{ struct CarTable: the cars of the judge, by dense car index */
+// NOTE: structure of arrays, a car is an index (id ascending) and each of its
+//       fields lies in its own array, so a pass over the cars of a lane reads
+//       contiguous ints instead of chasing car objects.
+//   -- a car is FINISH until `init` gives it a route, cars without one never run.
+//   -- the direction of a road is 0 from `from` to `to`, 1 back.
+//   -- the routes of all cars lie in one arena, a hop is the directed road
+//      (edge) index of Network, 2 * road + dir, or ~(2 * road) for a road that
+//      does not go on from the hop before. the entry cross of a hop is the
+//      start of its edge, no lookup.
 class RoadOnline;
-class Cross;
-class RunningCar : virtual public Car {
-public:
-  RunningCar(int i, int from, int to, int speed, int plan_time, int priority, int preset)
-    : Car(i, from, to, speed, plan_time, priority, preset) {}
+struct CarTable {
+  CarTable() : roads(nullptr) {}
 
-  int         get_start_time()           const;
-  int         get_current_road_pos()     const;
-  State       get_state()                const;
-  int         get_current_road_channel() const;
-  RoadOnline* get_src_road()             const;
-  int         get_end_time()             const;
+  // static, from the car file.
+  std::vector<int>  id, from, speed, plan_time, priority, preset;
 
-  // for deadlock info.
-  int         get_current_road_id();
-  int         get_current_road_goto_id();
+  // the route: hops [path_begin, path_begin + path_size) of `path_arena`.
+  //   -- XXX: a car routed twice leaves its old hops in the arena.
+  std::vector<int>  path_arena;
+  std::vector<int>  path_begin, path_size;
+  std::vector<int>  start_time;
 
-  bool is_conflict() const;
+  // the roads of the judge by dense index, the road of a hop.
+  RoadOnline       *roads;
 
-  void set_current_road_pos(const int p);
-  void set_current_road_channel(const int channel);
-  void set_state(const State s);
-  void set_current_road_idx(const std::size_t idx);
+  // dynamic, per tick.
+  std::vector<int>  pos, next_pos, channel, hop, end_time;
+  std::vector<char> state;
 
-  void init(const int start_time, std::vector<RoadOnline*> &p, std::map<std::pair<RoadOnline*, RoadOnline*>, Cross*> &m, std::unordered_map<int, Cross*> &cs_id_to_pcs);
-  bool move_to_next_road();
+  Census census;
 
-  void drive(const int speed);
+  int  size() const { return this->id.size(); }
+  void add(const int i, const int f, const int sp, const int plan, const int prio, const int pre);
 
-protected:
-  int                      start_time_;
-  int                      end_time_;
-  int                      idx_of_current_road_;
-  int                      current_road_pos_;
-  int                      next_road_pos_;
-  int                      current_road_channel_;
-  State                    state_;
+  // NOTE: `first`..`last` the hops as in the arena.
+  void init(const int car, const int start, const int *first, const int *last);
 
-  std::vector<RoadOnline*> path_;
-  std::vector<Cross*>      start_cross_id_sequence_;
+  // NOTE: road index and direction (-1 if it does not go on) of hop `k` of `car`.
+  int hop_road(const int car, const int k) const;
+  int hop_dir(const int car, const int k) const;
+  RoadOnline *hop_road_online(const int car, const int k) const;
 
-private:
-  RunningCar() = default;
+  // NOTE: as the cars of the judge did, for a waiting car.
+  bool move_to_next_road(const int car);
+  void drive(const int car, const int sp);
+  bool is_conflict(const int car) const;
+
+  // NOTE: the car left its garage.
+  void count_departure();
+  // NOTE: after the last `++end_time` of the car.
+  void count_finish(const int car);
 };
 
-inline int
-RunningCar::get_start_time()
-  const
+inline void
+CarTable::add(const int i,
+              const int f,
+              const int sp,
+              const int plan,
+              const int prio,
+              const int pre)
 {
-  return this->start_time_;
+  this->id.push_back(i);
+  this->from.push_back(f);
+  this->speed.push_back(sp);
+  this->plan_time.push_back(plan);
+  this->priority.push_back(prio);
+  this->preset.push_back(pre);
+
+  this->path_begin.push_back(0);
+  this->path_size.push_back(0);
+  this->start_time.push_back(plan);
+
+  this->pos.push_back(0);
+  this->next_pos.push_back(0);
+  this->channel.push_back(-1);
+  this->hop.push_back(0);
+  this->end_time.push_back(0);
+  this->state.push_back(FINISH);
+  return;
 }
 
-inline int
-RunningCar::get_current_road_pos()
+inline bool
+CarTable::is_conflict(const int car)
   const
 {
-  return this->current_road_pos_;
+  // XXX: probably have some bugs.
+  return this->hop_dir(car, this->hop[car]) < 0;
 }
 
 inline int
-RunningCar::get_current_road_channel()
+CarTable::hop_road(const int car,
+                   const int k)
   const
 {
-  return this->current_road_channel_;
+  int e = this->path_arena[this->path_begin[car] + k];
+  return (e >= 0) ? (e >> 1) : (~e >> 1);
 }
 
-inline State
-RunningCar::get_state()
+inline int
+CarTable::hop_dir(const int car,
+                  const int k)
   const
 {
-  return this->state_;
+  int e = this->path_arena[this->path_begin[car] + k];
+  return (e >= 0) ? (e & 1) : -1;
 }
 
 inline void
-RunningCar::set_current_road_pos(const int p)
+CarTable::count_departure()
 {
-  this->current_road_pos_ = p;
+  ++(this->census.departed);
   return;
 }
 
 inline void
-RunningCar::set_current_road_channel(const int channel)
+CarTable::count_finish(const int car)
 {
-  this->current_road_channel_ = channel;
+  ++(this->census.finished);
+  this->census.end_time_sum += this->end_time[car];
   return;
 }
+/*}}}*/
+
+/*{{{ struct Garage: the cars of a road direction yet to enter it */
+// NOTE: a car waits in a pending min-heap by start time until it is due,
+//       then in `ready_priority` or `ready`, both in car index (id) order as
+//       the departures go, so a departure only looks at the cars allowed to enter.
+struct Garage {
+  typedef std::pair<int, int> Due; // (start time, car)
+  typedef std::priority_queue<Due, std::vector<Due>, std::greater<Due>> Pending;
+
+  Pending       pending_priority, pending;
+  std::set<int> ready_priority, ready;
+
+  void add(const int car, const int start_time, const bool is_priority);
+  // the cars due at `current_time` (non-decreasing from call to call) become ready.
+  void release(const int current_time);
+};
 
 inline void
-RunningCar::set_state(const State s)
+Garage::add(const int car,
+            const int start_time,
+            const bool is_priority)
 {
-  this->state_ = s;
+  (is_priority ? this->pending_priority : this->pending).push(std::make_pair(start_time, car));
   return;
 }
 
 inline void
-RunningCar::set_current_road_idx(const std::size_t idx)
+Garage::release(const int current_time)
 {
-  this->idx_of_current_road_ = idx;
+  while (!this->pending_priority.empty() && this->pending_priority.top().first <= current_time) {
+    this->ready_priority.insert(this->pending_priority.top().second);
+    this->pending_priority.pop();
+  }
+  while (!this->pending.empty() && this->pending.top().first <= current_time) {
+    this->ready.insert(this->pending.top().second);
+    this->pending.pop();
+  }
   return;
 }
+/*}}}*/
+
+class RoadInitCarList : public Road {
+public:
+  RoadInitCarList(int id, int len, int speed, int channel, int from, int to, int is_duplex, int *occupancy)
+    : Road(id, len, speed, channel, from, to, is_duplex)
+    , occupancy_(occupancy) {}
+
+  // NOTE: 0 for the cars from `from_` (to `to_`), 1 for the cars from `to_`, else -1.
+  int dir_from(const int start_cross_id) const;
+
+  void push(const CarTable &cars, const int car, const int dir);
+
+protected:
+  Garage garages_[2];
+
+  // NOTE: the cars in the garages or on the lanes, a slot of a dense array of
+  //       the owner, so the passes of a tick skip an idle road without visiting it.
+  int   *occupancy_;
+
+private:
+  RoadInitCarList() = default;
+};
 
 inline int
-RunningCar::get_end_time()
+RoadInitCarList::dir_from(const int start_cross_id)
   const
 {
-  return this->end_time_;
+  return (start_cross_id == this->from_) ? 0 : ((start_cross_id == this->to_) ? 1 : -1);
 }
-/*}}}*/
 
-class RoadInitCarList : public Road {
+inline void
+RoadInitCarList::push(const CarTable &cars,
+                      const int car,
+                      const int dir)
+{
+  if (0 == dir || 1 == dir) {
+    this->garages_[dir].add(car, cars.start_time[car], 0 != cars.priority[car]);
+    ++(*this->occupancy_);
+  }
+  return;
+}
+
+/*{{{ class Lane: the cars of one channel, front (nearest the exit) to back */
+// NOTE: a fixed-capacity ring buffer, a channel holds at most `length_` cars
+//       (one per position). cars enter at the back and leave from the front,
+//       so both are O(1), and a scan walks contiguous memory.
+class Lane {
 public:
-  RoadInitCarList(int id, int len, int speed, int channel, int from, int to, int is_duplex)
-    : Road(id, len, speed, channel, from, to, is_duplex) {}
-  void create_car_sequence_for_ready_car();
+  explicit Lane(const int length = 1);
 
-  void push(RunningCar* const p_car, const int start_cross_id);
+  class const_iterator {
+  public:
+    const_iterator(const Lane *lane, const int i) : lane_(lane), i_(i) {}
+    int operator*() const { return this->lane_->at(this->i_); }
+    const_iterator& operator++() { ++(this->i_); return *this; }
+    bool operator!=(const const_iterator &o) const { return this->i_ != o.i_; }
 
-protected:
-  std::list<RunningCar*> dir_cars_;
-  std::list<RunningCar*> inv_cars_;
+  private:
+    const Lane *lane_;
+    int         i_;
+  };
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end()   const { return const_iterator(this, this->size_); }
+
+  bool        empty() const;
+  int         size()  const;
+  int  at(const int i) const;
+  int  front() const;
+  int  back()  const;
+
+  void push_back(const int car);
+  void pop_front();
+
+  // NOTE: O(1) for the front car, the others shift the cars behind them.
+  void remove(const int car);
 
 private:
-  RoadInitCarList() = default;
+  void grow();
+
+  std::vector<int> buf_;
+  int              mask_;
+  int              head_;
+  int              size_;
 };
 
+inline
+Lane::Lane(const int length)
+  : mask_(0)
+  , head_(0)
+  , size_(0)
+{
+  int cap = 1;
+  while (cap < length) {
+    cap <<= 1;
+  }
+  this->buf_.assign(cap, -1);
+  this->mask_ = cap - 1;
+}
+
+inline bool
+Lane::empty()
+  const
+{
+  return 0 == this->size_;
+}
+
+inline int
+Lane::size()
+  const
+{
+  return this->size_;
+}
+
+inline int
+Lane::at(const int i)
+  const
+{
+  return this->buf_[(this->head_ + i) & this->mask_];
+}
+
+inline int
+Lane::front()
+  const
+{
+  return this->buf_[this->head_];
+}
+
+inline int
+Lane::back()
+  const
+{
+  return this->at(this->size_ - 1);
+}
+
+inline void
+Lane::push_back(const int car)
+{
+  if (this->size_ > this->mask_) {
+    this->grow(); // XXX: more cars than positions, should not happen.
+  }
+  this->buf_[(this->head_ + this->size_) & this->mask_] = car;
+  ++(this->size_);
+  return;
+}
+
+inline void
+Lane::pop_front()
+{
+  this->head_ = (this->head_ + 1) & this->mask_;
+  --(this->size_);
+  return;
+}
+
 inline void
-RoadInitCarList::push(RunningCar* const p_car,
-                      const int start_cross_id)
+Lane::remove(const int car)
 {
-  if (start_cross_id == this->from_) {
-    this->dir_cars_.push_back(p_car);
+  if (this->size_ > 0 && this->front() == car) {
+    this->pop_front();
+    return;
+  }
+
+  int i = 1;
+  while (i < this->size_ && this->at(i) != car) {
+    ++i;
+  }
+  if (i >= this->size_) {
+    return;
+  }
+  for (; i + 1 < this->size_; ++i) {
+    this->buf_[(this->head_ + i) & this->mask_] = this->at(i + 1);
   }
-  else if (start_cross_id == this->to_) {
-    this->inv_cars_.push_back(p_car);
+  --(this->size_);
+  return;
+}
+
+inline void
+Lane::grow()
+{
+  std::vector<int> buf(2 * this->buf_.size(), -1);
+  for (auto i = 0; i < this->size_; ++i) {
+    buf[i] = this->at(i);
   }
+  this->buf_.swap(buf);
+  this->mask_ = this->buf_.size() - 1;
+  this->head_ = 0;
   return;
 }
+/*}}}*/
 
-class RoadOnline : virtual public RoadInitCarList {
+class RoadOnline : public RoadInitCarList {
 public:
-  RoadOnline(int id, int len, int speed, int channel, int from, int to, int is_duplex)
-    : RoadInitCarList(id, len, speed, channel, from, to, is_duplex) {
-      this->dir_on_running_cars_ls_.resize(channel);
+  RoadOnline(int id, int len, int speed, int channel, int from, int to, int is_duplex, CarTable *cars, int *occupancy)
+    : RoadInitCarList(id, len, speed, channel, from, to, is_duplex, occupancy)
+    , cars_(cars) {
+      this->lanes_[0].assign(channel, Lane(len));
+      this->wait_prefix_[0].assign(channel, 0);
       if (1 == is_duplex) {
-        this->inv_on_running_cars_ls_.resize(channel);
+        this->lanes_[1].assign(channel, Lane(len));
+        this->wait_prefix_[1].assign(channel, 0);
       }
+      this->num_of_wait_[0] = this->num_of_wait_[1] = 0;
+      this->num_of_cars_[0] = this->num_of_cars_[1] = 0;
     }
 
-  int get_num_of_wait_cars(const int start_cross_id) const;
+  // NOTE: `dir` as CarTable, 0 for the cars driving towards `to_`, 1 towards `from_`.
+  int get_num_of_wait_cars(const int dir) const;
+  int get_num_of_running_cars(const int dir) const;
 
-  bool run_to_road(RunningCar* c, std::vector<std::list<RunningCar*>> &running_cars);
+  bool run_to_road(const int car, const int dir);
+  // NOTE: a priority car of the garage of `dir` could depart now, as run_to_road
+  //       would let it, the only departures of the wait phase.
+  bool can_depart_priority(const int dir, const int current_time) const;
   void run_car_in_init_list(const int current_time, const bool is_priority);
 
-  void drive_just_current_road(const int channel, const int start_cross_id, const bool for_wait_car);
+  void drive_just_current_road(const int channel, const int dir, const bool for_wait_car);
   void drive_just_current_road();
 
-  bool is_final_filled(const int start_cross_id);
-  std::pair<int, int> select_valid_channel(const int start_cross_id);
+  bool is_final_filled(const int dir) const;
+  std::pair<int, int> select_valid_channel(const int dir) const;
 
-  void remove_car(const int channel, const int start_cross_id, RunningCar* const car);
-  void push_back_car(const int channel, const int start_cross_id, RunningCar* const car);
+  void remove_car(const int channel, const int dir, const int car);
+  void push_back_car(const int channel, const int dir, const int car);
 
+  // NOTE: the waiting cars of a lane are a prefix of it (a car waits only to
+  //       pass the cross or behind a waiting car), so a direction keeps the
+  //       length of that prefix per lane, and the next car to pass is the best
+  //       lane front by (priority, position, lowest channel).
+  //   -- create_car_in_wait_sequence: count every lane, after phase one.
+  //   -- update_wait_sequence: count one lane again, after a car of it moved.
   void create_car_in_wait_sequence();
+  void update_wait_sequence(const int channel, const int dir);
 
-  RunningCar* get_front_car_from_wait_sequence(const int start_cross_id);
+  // NOTE: -1 if no car waits to leave the road in `dir`.
+  int get_front_car_from_wait_sequence(const int dir) const;
 
 protected:
-  std::vector<std::list<RunningCar*>> dir_on_running_cars_ls_;
-  std::list<RunningCar*>              dir_on_waiting_cars_ls_;
+  CarTable              *cars_;
 
-  std::vector<std::list<RunningCar*>> inv_on_running_cars_ls_;
-  std::list<RunningCar*>              inv_on_waiting_cars_ls_;
+  // [dir], the lanes of direction 1 only on a duplex road.
+  //   -- num_of_cars_: the cars on the lanes, the passes of a tick skip an empty direction.
+  std::vector<Lane>      lanes_[2];
+  std::vector<int>       wait_prefix_[2];
+  int                    num_of_wait_[2];
+  int                    num_of_cars_[2];
 
 private:
-  void run_car_in_init_list(const int current_time, const bool is_priority, std::list<RunningCar*> &init_list, std::vector<std::list<RunningCar*>> &running_cars);
-  void drive_just_current_road(const int channel, std::vector<std::list<RunningCar*>> &cars, const bool for_wait_car);
+  int  count_wait_prefix(const Lane &lane) const;
+  void run_car_in_init_list(const int current_time, const bool is_priority, const int dir);
 };
 
 inline int
-RoadOnline::get_num_of_wait_cars(const int start_cross_id)
-  const
-{
-  if (start_cross_id == this->from_) {
-    return this->dir_on_waiting_cars_ls_.size();
-  }
-  else if (start_cross_id == this->to_) {
-    return this->inv_on_waiting_cars_ls_.size();
-  }
-  return 0;
-}
-
-inline bool
-RunningCar::is_conflict()
+RoadOnline::get_num_of_wait_cars(const int dir)
   const
 {
-  // XXX: probably have some bugs.
-  auto idx = this->idx_of_current_road_;
-  auto cross_id = this->start_cross_id_sequence_[idx]->get_id();
-  return this->path_[idx]->get_from() != cross_id && this->path_[idx]->get_to() != cross_id;
+  return this->num_of_wait_[dir];
 }
 
-inline RoadOnline*
-RunningCar::get_src_road()
+inline int
+RoadOnline::count_wait_prefix(const Lane &lane)
   const
 {
-  if (this->path_.empty()) {
-    return nullptr;
+  const std::vector<char> &state = this->cars_->state;
+  int n = 0, sz = lane.size();
+  while (n < sz && WAIT == state[lane.at(n)]) {
+    ++n;
   }
-  return this->path_[0];
+  return n;
 }
 
 inline int
-RunningCar::get_current_road_id()
+RoadOnline::get_num_of_running_cars(const int dir)
+  const
 {
-  auto idx = this->idx_of_current_road_;
-  return this->path_[idx]->get_id();
+  return this->num_of_cars_[dir];
 }
 
-inline int
-RunningCar::get_current_road_goto_id()
+// NOTE: out of CarTable, the road is complete here.
+inline RoadOnline*
+CarTable::hop_road_online(const int car,
+                          const int k)
+  const
 {
-  auto idx = this->idx_of_current_road_;
-  auto start_cross_id = this->start_cross_id_sequence_[idx]->get_id();
-  if (start_cross_id == this->path_[idx]->get_to()) {
-    return this->path_[idx]->get_from();
-  }
-  else if (start_cross_id == this->path_[idx]->get_from()) {
-    return this->path_[idx]->get_to();
-  }
-  return -1;
+  return this->roads + this->hop_road(car, k);
 }
 #endif // ifndef _TRAFFIC_HPP_
@@ -5,161 +5,123 @@
  * Distributed under terms of the GPL license.
  */
 
-#include <limits>    // std::numeric_limits<double>::infinity()
-#include <algorithm> // std::reverse
-#include <queue>     // std::priority_queue
+#include <algorithm> // std::sort
+#include <unordered_map>
 
 #include <cmath>     // std::pow
+#include <stdexcept> // std::invalid_argument, std::out_of_range
 
 #include "model.hpp"
 
+namespace {
+
+// NOTE: the whole of `s` as a number, false on anything else (no exception).
+bool
+parse_int(const std::string &s,
+          int &out)
+{
+  try {
+    std::size_t pos = 0;
+    int v = std::stoi(s, &pos);
+    if (pos != s.size()) {
+      return false;
+    }
+    out = v;
+    return true;
+  } catch (const std::invalid_argument &) {
+    return false;
+  } catch (const std::out_of_range &) {
+    return false;
+  }
+}
+
+bool
+parse_double(const std::string &s,
+             double &out)
+{
+  try {
+    std::size_t pos = 0;
+    double v = std::stod(s, &pos);
+    if (pos != s.size()) {
+      return false;
+    }
+    out = v;
+    return true;
+  } catch (const std::invalid_argument &) {
+    return false;
+  } catch (const std::out_of_range &) {
+    return false;
+  }
+}
+
+} // namespace
+
 /*{{{ initialization of model index to orginal data index */
 void
 Model::initIndex()
 {
+  PROFILE_PHASE("initIndex");
+
   // NOTE: call the method after model initialization.
-  int sz = this->raw_crosses_.size();
+  int sz = this->network_.cross_size();
 
   this->size_ = sz;
   this->node_info_.resize(sz);
-  this->adjacency_.resize(sz);
-  this->cross_index_to_passby_cars_.resize(sz);
 
-  // NOTE: create cross_id_to_index.
   for (auto i = 0; i < sz; ++i) {
-    this->cross_id_to_index_[this->raw_crosses_[i].id] = i;
-    this->node_info_[i].index                          = i;
+    this->node_info_[i].index = i;
   }
 
-  // NOTE: create cross_index_to_road_info_,
-  //        adjacency_, road_id_to_cross_index_, from_road_id_to_to_id_.
-  //   -- extract raw_roads information we need.
-  sz = this->raw_roads_.size();
-  int from, to, from_idx, to_idx;
-  for (auto i = 0; i < sz; ++i) {
-    from     = this->raw_roads_[i].from;
-    to       = this->raw_roads_[i].to;
-    this->from_road_id_to_to_id_[from][this->raw_roads_[i].id] = to;
-
-    from_idx = this->cross_id_to_index_[from];
-    to_idx   = this->cross_id_to_index_[to];
-
-    // NOTE: road_id --> (from_cross_index, to_cross_index)
-    this->road_id_to_cross_index_[this->raw_roads_[i].id] = std::make_pair(from_idx, to_idx);
-
-    this->adjacency_[from_idx].push_back(to_idx);
-    this->cross_index_to_road_info_[{ from_idx, to_idx }].id      = this->raw_roads_[i].id;
-    this->cross_index_to_road_info_[{ from_idx, to_idx }].len     = this->raw_roads_[i].len;
-    this->cross_index_to_road_info_[{ from_idx, to_idx }].speed   = this->raw_roads_[i].speed;
-    this->cross_index_to_road_info_[{ from_idx, to_idx }].channel = this->raw_roads_[i].channel;
-    if (0 != this->raw_roads_[i].is_duplex) {
-      this->cross_index_to_road_info_[{ to_idx, from_idx }].id      = this->raw_roads_[i].id;
-      this->cross_index_to_road_info_[{ to_idx, from_idx }].len     = this->raw_roads_[i].len;
-      this->cross_index_to_road_info_[{ to_idx, from_idx }].speed   = this->raw_roads_[i].speed;
-      this->cross_index_to_road_info_[{ to_idx, from_idx }].channel = this->raw_roads_[i].channel;
-
-      this->adjacency_[to_idx].push_back(from_idx);
-      this->from_road_id_to_to_id_[to][this->raw_roads_[i].id] = from;
-    }
+  // NOTE: create road_info_ for each directed road.
+  //   -- extract road information we need.
+  this->edge_size_ = this->network_.edge_size();
+  this->road_info_.resize(this->edge_size_);
+  for (auto e = 0; e < this->edge_size_; ++e) {
+    const RawRoad &rd = this->network_.road(this->network_.edge_road(e));
+    this->road_info_[e].id      = rd.id;
+    this->road_info_[e].len     = rd.len;
+    this->road_info_[e].speed   = rd.speed;
+    this->road_info_[e].channel = rd.channel;
+    this->road_info_[e].index   = e;
+    this->road_info_[e].volumn  = 0;
   }
 
-  // NOTE: map preset car id to index.
-  sz = this->raw_preset_cars_.size();
-  for (auto i = 0; i < sz; ++i) {
-    this->preset_car_id_to_index_[this->raw_preset_cars_[i].id] = i;
+  this->total_slots_ = 0.0;
+  for (auto e = 0; e < this->edge_size_; ++e) {
+    if (this->network_.edge_valid(e)) {
+      this->total_slots_ += (double) this->road_info_[e].len * this->road_info_[e].channel;
+    }
   }
 
   // NOTE: save preset car's path.
-  sz = this->raw_cars_.size();
+  sz = this->network_.car_size();
   for (auto i = 0; i < sz; ++i) {
-    from_idx = this->cross_id_to_index_[this->raw_cars_[i].from];
-    to_idx   = this->cross_id_to_index_[this->raw_cars_[i].to];
-
-    StartEndInfo start_end(this->raw_cars_[i].id,
-                           this->raw_cars_[i].plan_time,
-                           from_idx,
-                           to_idx,
-                           this->raw_cars_[i].speed,
-                           this->raw_cars_[i].priority,
-                           this->raw_cars_[i].preset);
-
-    if (this->raw_cars_[i].preset != 0) {
-      int idx = this->preset_car_id_to_index_[this->raw_cars_[i].id];
+    const RawCar &car = this->network_.car(i);
+
+    StartEndInfo start_end(car.id,
+                           car.plan_time,
+                           this->network_.car_from(i),
+                           this->network_.car_to(i),
+                           car.speed,
+                           car.priority,
+                           car.preset);
+
+    int idx = this->network_.preset_index(i);
+    if (car.preset != 0 && idx >= 0) {
+      const RawPresetCar &preset = this->network_.preset_cars()[idx];
       std::vector<int> cross_seq = this->transform_original_path_to_cross_index(
-          this->raw_cars_[i].from,
-          this->raw_preset_cars_[idx].road_path,
-          this->raw_cars_[i].to);
+          car.from,
+          preset.road_path,
+          car.to);
 
       start_end.cross_index_seq.assign(cross_seq.begin(), cross_seq.end());
     }
     this->cars_to_run_.push_back(start_end);
   }
 
-  return;
-}
-/*}}}*/
+  this->road_load_.resize(this->edge_size_);
 
-/*{{{ dijkstra algorihtm(st, cmp, cost) */
-Feedback
-Model::dijkstra(StartEndInfo &start_end,
-                std::function<bool (const NodeInfo&, const NodeInfo&)> cmp,
-                std::function<int (const StartEndInfo&, const RoadInfo&, const NodeInfo&)> cost)
-{
-  Feedback fb; fb.t_path.clear();
-  std::priority_queue<NodeInfo,
-                      std::vector<NodeInfo>,
-                      decltype(cmp)> pq(cmp);
-
-  std::vector<int> trace (this->size_);
-  std::vector<double> dist (this->size_, std::numeric_limits<double>::infinity());
-
-  NodeInfo src;
-  src.cost_time    = start_end.start_time;
-  src.index        = start_end.from_index;
-  src.volumn       = this->node_info_[src.index].volumn;
-
-  RoadInfo tmp;
-  tmp.id = -1; tmp.len = 0; tmp.speed = 0x3f3f3f3f; tmp.channel = 0x3f3f3f3f;
-  dist[src.index]  = cost(start_end, tmp, src);
-  trace[src.index] = -1;
-
-  pq.push(src);
-
-  int len, limit, min_v, v_cost_time;
-  double w;
-
-  while (!pq.empty()) {
-    NodeInfo u = pq.top();
-    pq.pop();
-    for (auto &v_idx : this->adjacency_[u.index]) {
-      RoadInfo r  = this->cross_index_to_road_info_[{ u.index, v_idx }];
-      len         = r.len;
-      limit       = r.speed;
-      min_v       = std::min(start_end.speed, limit);
-      v_cost_time = (len + min_v - 1) / min_v;
-
-      this->node_info_[v_idx].cost_time = v_cost_time + u.cost_time;
-      w = (double) cost(start_end, r, this->node_info_[v_idx]);
-
-      if (dist[v_idx] > dist[u.index] + w) {
-        dist[v_idx]  = dist[u.index] + w;
-        trace[v_idx] = u.index;
-        pq.push(this->node_info_[v_idx]);
-      }
-    }
-  }
-
-  int to = start_end.to_index;
-  while (trace[to] != -1) {
-    fb.t_path.push_back(to);
-    to = trace[to];
-  }
-
-  fb.t_path.push_back(start_end.from_index);
-  reverse(fb.t_path.begin(), fb.t_path.end());
-  fb.cost_time = this->node_info_[start_end.to_index].cost_time - start_end.start_time;
-
-  return fb;
+  return;
 }
 /*}}}*/
 
@@ -202,6 +164,7 @@ Model::make_logistics_like()
 void
 Model::probe()
 {
+  this->load_preset_profile();
   this->compute_hotspot();
 
   // std::random_shuffle(this->cars_to_run_.begin(), this->cars_to_run_.end(),
@@ -209,109 +172,642 @@ Model::probe()
   return;
 }
 
+// NOTE: anytime: the shortest route plan is always made first, then the routing
+//       mode refines it while the budget lasts, the better plan is kept. a
+//       plan in progress when the budget expires is finished, from the routes
+//       it has so far.
 void
 Model::run()
 {
   this->probe();
+  this->log_budget("probe");
+
+  const std::vector<StartEndInfo> base = this->cars_to_run_;
+  this->make_plan("shortest", [this]() { this->assign_shortest(); });
+
+  if (!this->is_stopped()) {
+    this->cars_to_run_ = base;
+    if (this->routing_mode_ != ROUTING_SPLIT) {
+      this->make_plan("equilibrium", [this]() { this->assign_equilibrium(); });
+    } else {
+      this->make_plan("split", [this]() { this->assign_routes(); });
+    }
+  }
 
+  if (this->routing_mode_ == ROUTING_ONLINE && !this->is_stopped()) {
+    this->make_online_plan();
+  }
+
+  return;
+}
+
+void
+Model::make_plan(const char *name,
+                 std::function<void ()> assign)
+{
+  /*{{{ reset the state of the previous plan */
+  for (auto &r : this->road_info_) {
+    r.volumn = 0;
+  }
+  for (auto &load : this->road_load_) {
+    load.clear();
+  }
+  /*}}}*/
+
+  assign();
+
+  this->schedule_departure();
+
+  // NOTE: estimated makespan, then total travel time of the non-preset cars.
+  long long makespan = 0, total = 0;
   for (auto &st : this->cars_to_run_) {
     if (st.is_preset != 0) {
-      // TODO: ?
-      for (auto idx : st.cross_index_seq) {
-        ++(this->node_info_[idx].volumn);
+      continue;
+    }
+    long long arrive = st.start_time + this->compute_estimate_cost(st.speed, st.cross_index_seq, st.start_time);
+    makespan = std::max(makespan, arrive);
+    total   += arrive;
+  }
+  bool is_better = this->plan_.empty() ||
+                   makespan < this->best_score_.first ||
+                   (makespan == this->best_score_.first && total < this->best_score_.second);
+  if (this->verbose_) {
+    std::cout << "plan " << name << ": estimated makespan = " << makespan
+              << ", total = " << total << (is_better ? " (best)" : "") << std::endl;
+  }
+
+  std::vector<std::vector<int>> plan;
+  {
+    PROFILE_PHASE("make_answers");
+    for (auto &st : this->cars_to_run_) {
+      if (st.is_preset == 1 || st.cross_index_seq.size() < 2) {
+        continue; // NOTE: an unreachable car has no road, reported by compute_hotspot().
       }
+      std::vector<int> tmp;
+      tmp.push_back(st.id);
+      tmp.push_back(st.start_time);
+      std::vector<int> road_path = this->transform_path(st.cross_index_seq);
+
+      tmp.insert(tmp.end(), road_path.begin(), road_path.end());
+      plan.push_back(tmp);
+    }
+  }
+
+  // NOTE: the answers are the plan the judge finishes best. a plan it deadlocks
+  //       on is written only while no plan is finished, the best estimate then.
+  std::pair<long long, long long> judged;
+  bool is_finished = this->judge_plan(plan, judged);
+  bool is_answer   = is_finished ? (!this->is_accepted_ || judged < this->answer_score_)
+                                 : (!this->is_accepted_ && is_better);
+  if (this->verbose_) {
+    if (is_finished) {
+      std::cout << "plan " << name << ": schedule time = " << judged.first << ", all schedule time = " << judged.second
+                << (is_answer ? " (answers)" : "") << std::endl;
+    } else {
+      std::cout << "plan " << name << ": deadlock" << std::endl;
+    }
+  }
+  if (is_answer) {
+    this->answers_      = plan;
+    this->answer_score_ = judged;
+    this->is_accepted_  = is_finished;
+  }
+  if (is_better) {
+    this->best_score_ = std::make_pair(makespan, total);
+    this->plan_.swap(plan);
+  }
+
+  this->log_budget(name);
+  return;
+}
+
+bool
+Model::judge_plan(const std::vector<std::vector<int>> &plan,
+                  std::pair<long long, long long> &score)
+{
+  PROFILE_PHASE("judge_plan");
+
+  CoSimulation sim(this->car_path_, this->road_path_, this->cross_path_, this->preset_path_,
+                   this->renumber_, *this->path_engine_, 1,
+                   this->online_weight_, this->online_margin_);
+  std::vector<std::vector<int>> simulated;
+  if (!sim.run(plan, false, nullptr, simulated)) {
+    return false;
+  }
+  score = std::make_pair((long long) sim.schedule_time(), sim.all_schedule_time());
+  return true;
+}
+
+void
+Model::make_online_plan()
+{
+  CoSimulation sim(this->car_path_, this->road_path_, this->cross_path_, this->preset_path_,
+                   this->renumber_, *this->path_engine_, this->threads_,
+                   this->online_weight_, this->online_margin_);
+  const std::atomic<bool> *stop = this->watchdog_ ? &this->watchdog_->stop() : nullptr;
+
+  // NOTE: the best estimated plan co-simulated, it replaces the answers only
+  //       when the judge finishes it earlier than the answers (if at all).
+  std::vector<std::vector<int>> simulated;
+  if (this->is_stopped() || !sim.run(this->plan_, true, stop, simulated)) {
+    if (this->verbose_) {
+      std::cout << "plan online: deadlock or stopped" << std::endl;
+    }
+    this->log_budget("online");
+    return;
+  }
+
+  std::pair<long long, long long> online((long long) sim.schedule_time(), sim.all_schedule_time());
+  bool is_better = !this->is_accepted_ || online < this->answer_score_;
+  if (this->verbose_) {
+    std::cout << "plan online: schedule time = " << online.first << ", all schedule time = " << online.second
+              << (is_better ? " (best)" : "") << std::endl;
+  }
+  if (is_better) {
+    this->answers_.swap(simulated);
+    this->answer_score_ = online;
+    this->is_accepted_  = true;
+  }
+  this->log_budget("online");
+  return;
+}
+
+bool
+Model::set_parameter(const std::string &key,
+                     const std::string &value)
+{
+  if (key == "mode") {
+    if (value == "split") {
+      this->routing_mode_ = ROUTING_SPLIT;
+    } else if (value == "equilibrium") {
+      this->routing_mode_ = ROUTING_EQUILIBRIUM;
+    } else if (value == "online") {
+      this->routing_mode_ = ROUTING_ONLINE;
+    } else {
+      return false;
+    }
+  } else if (key == "capacity_rate") {
+    double rate = 0.0;
+    if (!parse_double(value, rate) || !(rate > 0.0 && rate <= 1.0)) {
+      return false;
+    }
+    this->road_capacity_rate_ = rate;
+  } else if (key == "eq_iter") {
+    int iter = 0;
+    if (!parse_int(value, iter) || iter <= 0) {
+      return false;
+    }
+    this->eq_max_iter_ = iter;
+  } else if (key == "eq_gap") {
+    double gap = 0.0;
+    if (!parse_double(value, gap) || !(gap >= 0.0)) {
+      return false;
+    }
+    this->eq_gap_ = gap;
+  } else if (key == "eq_horizon") {
+    int horizon = 0;
+    if (!parse_int(value, horizon) || horizon <= 0) {
+      return false;
+    }
+    this->eq_horizon_ = horizon;
+  } else if (key == "online_weight") {
+    double weight = 0.0;
+    if (!parse_double(value, weight) || !(weight >= 0.0)) {
+      return false;
+    }
+    this->online_weight_ = weight;
+  } else if (key == "online_margin") {
+    double margin = 0.0;
+    if (!parse_double(value, margin) || !(margin >= 0.0)) {
+      return false;
+    }
+    this->online_margin_ = margin;
+  } else if (key == "apsp_mb") {
+    // NOTE: at most 1 TiB, the shift fits std::size_t.
+    const int max_mb = 1 << 20;
+    int mb = 0;
+    if (!parse_int(value, mb) || mb < 0 || mb > max_mb) {
+      return false;
+    }
+    this->apsp_max_bytes_ = (std::size_t) mb << 20;
+  } else if (key == "delay_table") {
+    return this->load_delay_table(value);
+  } else if (key == "preset_profile") {
+    this->use_preset_profile_ = value != "0";
+  } else if (key == "preset_cache") {
+    this->preset_cache_ = value;
+  } else if (key == "verbose") {
+    this->verbose_ = value != "0";
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/*{{{ OD-demand aggregation and flow splitting */
+void
+Model::aggregate_demand()
+{
+  PROFILE_PHASE("aggregate_demand");
+
+  this->commodities_.clear();
+  std::unordered_map<long long, int> key_to_commodity;
+  long long n = this->size_;
+  int sz = this->cars_to_run_.size();
+  for (auto i = 0; i < sz; ++i) {
+    const StartEndInfo &st = this->cars_to_run_[i];
+    if (st.is_preset != 0) {
       continue;
     }
+    long long key = ((long long) st.speed * n + st.from_index) * n + st.to_index;
+    auto it = key_to_commodity.find(key);
+    if (it == key_to_commodity.end()) {
+      it = key_to_commodity.insert({ key, (int) this->commodities_.size() }).first;
+      this->commodities_.push_back(Commodity(st.from_index, st.to_index, st.speed));
+    }
+    this->commodities_[it->second].cars.push_back(i);
+  }
 
-    Feedback fb = this->dijkstra(st, this->priority_cmp, this->cost_func);
-    st.cross_index_seq.assign(fb.t_path.begin(), fb.t_path.end());
-    for (auto idx : fb.t_path) {
-      ++(this->node_info_[idx].volumn);
+  // NOTE: earlier cars take their share first.
+  for (auto &cm : this->commodities_) {
+    std::sort(cm.cars.begin(), cm.cars.end(),
+        [this](const int a, const int b) -> bool {
+          const StartEndInfo &x = this->cars_to_run_[a], &y = this->cars_to_run_[b];
+          return x.priority > y.priority ||
+                 (x.priority == y.priority && x.start_time < y.start_time) ||
+                 (x.priority == y.priority && x.start_time == y.start_time && x.id < y.id);
+        });
+  }
+  return;
+}
+
+double
+Model::route_capacity(const Route &r,
+                      const double routed)
+{
+  // NOTE: bottleneck `len * channel`, shrunk by the load of its roads relative
+  //       to the network average `routed / total_slots_`.
+  double cap  = 0.0;
+  double load = 0.0;
+  for (auto e : r.edges) {
+    double c = (double) this->road_info_[e].len * this->road_info_[e].channel;
+    if (cap == 0.0 || c < cap) {
+      cap = c;
     }
+    load += this->road_load(e);
   }
+  return std::max(1.0, cap) / (1.0 + this->route_volumn_weight_ * load * this->total_slots_ / routed);
+}
 
-  this->compute_passby_cars();
-  this->compute_cars_hot();
+void
+Model::assign_routes()
+{
+  PROFILE_PHASE("route");
 
-  // TODO: compute start time twice.
-  std::sort(this->cars_to_run_.begin(), this->cars_to_run_.end(),
-      [](const StartEndInfo &a, const StartEndInfo &b) -> bool {
-        return a.hot > b.hot;
-      });
+  for (auto &st : this->cars_to_run_) {
+    if (st.is_preset != 0) {
+      // TODO: ?
+      this->add_road_volumn(st.cross_index_seq, 1);
+    }
+  }
 
-  int total = this->cars_to_run_.size();
+  std::vector<double> share;
+  double routed = 1.0;
+  for (auto &cm : this->commodities_) {
+    const std::vector<Route> &routes = this->path_engine_->get(cm.from_index, cm.to_index, cm.speed);
+    int k = routes.size();
+    if (k == 0) {
+      continue; // XXX: unreachable.
+    }
 
-  //  -- step 1: for part hot car.
-  double start_t = (double) this->start_time_;
-  int part       = (int) total * this->first_schedule_rate_;
-  double step1   = (double) this->latest_time_ * this->first_schedule_time_rate_ / (double) part; // key.
-  for (int i = 0; i < part; ++i) {
-    this->cars_to_run_[i].start_time = std::max(this->cars_to_run_[i].start_time, (int)start_t);
-    start_t += step1;
+    share.assign(k, 0.0);
+    for (auto i = 0; i < k; ++i) {
+      share[i] = this->route_capacity(routes[i], routed);
+    }
+    this->deal_cars(cm, routes, share);
+    routed += cm.cars.size();
   }
 
-  //  -- step 2: for remain car contail cold car.
-  // std::random_shuffle(this->cars_to_run_.begin(), this->cars_to_run_.end(),
-  //                     this->random_call);
-  // NOTICE?
-  start_t = 1;
-  std::sort(this->cars_to_run_.begin(), this->cars_to_run_.end(),
-      [](const StartEndInfo &a, const StartEndInfo &b) -> bool {
-        return a.priority > b.priority ||
-               (a.priority == b.priority && a.estimate_cost_time < b.estimate_cost_time);
-      });
-  double step2 = (double) this->latest_time_ / (double) total;
-  for (int i = 0; i < total; ++i) {
-    if (this->cars_to_run_[i].is_preset != 1) {
-      this->cars_to_run_[i].start_time = std::max(this->cars_to_run_[i].start_time, (int) start_t);
+  return;
+}
+
+void
+Model::assign_equilibrium()
+{
+  PROFILE_PHASE("route");
+
+  // NOTE: cars a road passes over the horizon at `road_capacity_rate_` occupancy,
+  //       the preset cars are the background flow.
+  std::vector<double> capacity(this->edge_size_, 0.0), background(this->edge_size_, 0.0);
+  for (auto &r : this->road_info_) {
+    capacity[r.index] = this->road_capacity_rate_ * r.channel * r.speed * this->eq_horizon_;
+  }
+  for (auto &st : this->cars_to_run_) {
+    if (st.is_preset != 0) {
+      this->add_road_volumn(st.cross_index_seq, 1);
     }
-    start_t += step2;
   }
+  for (auto &r : this->road_info_) {
+    background[r.index] = r.volumn;
+  }
+
+  Equilibrium eq(*this->path_engine_, capacity, background, this->threads_);
+  for (auto &cm : this->commodities_) {
+    eq.add_demand(cm.from_index, cm.to_index, cm.speed, cm.cars.size());
+  }
+  eq.solve(this->eq_max_iter_, this->eq_gap_, this->watchdog_ ? &this->watchdog_->stop() : nullptr, this->verbose_);
+
+  int sz = this->commodities_.size();
+  for (auto i = 0; i < sz; ++i) {
+    if (!eq.paths(i).empty()) {
+      this->deal_cars(this->commodities_[i], eq.paths(i), eq.flows(i));
+    }
+  }
+  return;
+}
+
+void
+Model::assign_shortest()
+{
+  PROFILE_PHASE("route");
 
   for (auto &st : this->cars_to_run_) {
-    if (st.is_preset == 1) {
-      continue;
+    if (st.is_preset != 0) {
+      this->add_road_volumn(st.cross_index_seq, 1);
     }
-    std::vector<int> tmp;
-    tmp.push_back(st.id);
-    tmp.push_back(st.start_time);
-    std::vector<int> road_path = this->transform_path(st.cross_index_seq);
+  }
 
-    tmp.insert(tmp.end(), road_path.begin(), road_path.end());
-    this->answers_.push_back(tmp);
+  const std::vector<double> share(1, 1.0);
+  for (auto &cm : this->commodities_) {
+    const std::vector<Route> &routes = this->path_engine_->get(cm.from_index, cm.to_index, cm.speed);
+    if (!routes.empty()) {
+      this->deal_cars(cm, std::vector<Route>(1, routes.front()), share);
+    }
   }
+  return;
+}
 
+void
+Model::deal_cars(const Commodity &cm,
+                 const std::vector<Route> &routes,
+                 const std::vector<double> &share)
+{
+  int k = routes.size();
+  double total = 0.0;
+  for (auto s : share) {
+    total += s;
+  }
+  std::vector<double> given(k, 0.0);
+
+  // NOTE: each car goes to the route lagging most behind its share, so the
+  //       routes interleave over the departure order.
+  int assigned = 0;
+  for (auto car : cm.cars) {
+    ++assigned;
+    int best = 0;
+    double best_lag = 0.0;
+    for (auto i = 0; i < k; ++i) {
+      double lag = assigned * share[i] / total - given[i];
+      if (i == 0 || lag > best_lag) {
+        best     = i;
+        best_lag = lag;
+      }
+    }
+    given[best] += 1.0;
+
+    StartEndInfo &st = this->cars_to_run_[car];
+    st.cross_index_seq.assign(routes[best].cross_seq.begin(), routes[best].cross_seq.end());
+    for (auto e : routes[best].edges) {
+      ++(this->road_info_[e].volumn);
+    }
+  }
   return;
 }
+/*}}}*/
+
+/*{{{ road delay table */
+bool
+Model::load_delay_table(const std::string &path)
+{
+  std::vector<std::vector<int>> rows;
+  read_from_file(path, DELAY_SIZE, rows);
+  if (rows.empty()) {
+    return false;
+  }
+
+  // NOTE: buckets with fewer samples fall back to the road's overall factor.
+  const int min_samples = 5;
+
+  this->delay_bucket_ = std::max(1, rows[0][DELAY_BUCKET_LEN]);
+  this->delay_factor_.assign(this->edge_size_, std::vector<double>());
+  this->edge_factor_.assign(this->edge_size_, 1.0);
+  std::vector<double> delay(this->edge_size_, 0.0), free(this->edge_size_, 0.0);
+
+  for (auto &v : rows) {
+    int r = this->network_.road_index(v[DELAY_ROAD_ID]);
+    int c = this->network_.cross_index(v[DELAY_FROM]);
+    int e = (r < 0 || c < 0) ? -1 : this->network_.edge_of(r, c);
+    if (e < 0 || v[DELAY_FREE_SUM] <= 0) {
+      continue; // XXX: the table belongs to another map.
+    }
+    delay[e] += v[DELAY_SUM];
+    free[e]  += v[DELAY_FREE_SUM];
+    if (v[DELAY_COUNT] >= min_samples) {
+      int b = v[DELAY_BUCKET_START] / this->delay_bucket_;
+      std::vector<double> &f = this->delay_factor_[e];
+      if ((int) f.size() <= b) {
+        f.resize(b + 1, 0.0);
+      }
+      f[b] = std::max(1.0, (double) v[DELAY_SUM] / v[DELAY_FREE_SUM]);
+    }
+  }
+  for (auto e = 0; e < this->edge_size_; ++e) {
+    if (free[e] > 0.0) {
+      this->edge_factor_[e] = std::max(1.0, delay[e] / free[e]);
+    }
+  }
+  std::cout << "delay table: " << rows.size() << " rows, bucket " << this->delay_bucket_ << " ticks" << std::endl;
+  return true;
+}
+/*}}}*/
+
+/*{{{ preset occupancy profile */
+void
+Model::load_preset_profile()
+{
+  PROFILE_PHASE("preset_profile");
+
+  this->preset_load_.clear();
+  if (!this->use_preset_profile_ || this->network_.preset_cars().empty()) {
+    return;
+  }
+  if (!this->preset_profile_.load(this->preset_cache_)) {
+    return;
+  }
+
+  this->preset_load_.resize(this->edge_size_);
+  for (auto &v : this->preset_profile_.rows()) {
+    int r = this->network_.road_index(v[OCCUPANCY_ROAD_ID]);
+    int c = this->network_.cross_index(v[OCCUPANCY_FROM]);
+    int e = (r < 0 || c < 0) ? -1 : this->network_.edge_of(r, c);
+    if (e < 0 || v[OCCUPANCY_TICK] < 0) {
+      continue; // XXX: the profile belongs to another map.
+    }
+    std::vector<int> &load = this->preset_load_[e];
+    if ((int) load.size() <= v[OCCUPANCY_TICK]) {
+      load.resize(v[OCCUPANCY_TICK] + 1, 0);
+    }
+    load[v[OCCUPANCY_TICK]] = v[OCCUPANCY_CARS];
+  }
+  if (this->verbose_) {
+    std::cout << "preset profile: " << this->preset_profile_.rows().size() << " rows"
+              << (this->preset_profile_.is_cached() ? " (cached)" : "") << std::endl;
+  }
+  this->log_budget("preset profile");
+  return;
+}
+/*}}}*/
+
+/*{{{ capacity-aware departure scheduler */
+int
+Model::find_departure_time(const int speed,
+                           const std::vector<int> &cross_idx,
+                           const int earliest)
+{
+  int start_time = earliest;
+  int sz = cross_idx.size();
+  bool is_valid = false;
+  while (!is_valid) {
+    is_valid = true;
+    int t = start_time;
+    for (int i = 1; i < sz && is_valid; ++i) {
+      RoadInfo &r = this->road_info_[this->network_.edge_between(cross_idx[i - 1], cross_idx[i])];
+      int cost    = this->network_.travel_time(r.index, speed);
+      int limit   = std::max(1, (int) (r.len * r.channel * this->road_capacity_rate_));
+
+      // NOTE: scan backward, the latest overloaded tick decides how far to shift.
+      std::vector<int> &load = this->road_load_[r.index];
+      int last = std::min(t + cost, (int) load.size()) - 1;
+      for (int k = last; k >= t; --k) {
+        if (load[k] >= limit) {
+          start_time += k - t + 1;
+          is_valid    = false;
+          break;
+        }
+      }
+      t += cost;
+    }
+  }
+  return start_time;
+}
+
+void
+Model::commit_departure(const int speed,
+                        const std::vector<int> &cross_idx,
+                        const int start_time)
+{
+  int sz = cross_idx.size();
+  int t  = start_time;
+  for (int i = 1; i < sz; ++i) {
+    RoadInfo &r = this->road_info_[this->network_.edge_between(cross_idx[i - 1], cross_idx[i])];
+    int cost    = this->network_.travel_time(r.index, speed);
+
+    std::vector<int> &load = this->road_load_[r.index];
+    if ((int) load.size() < t + cost) {
+      load.resize(t + cost, 0);
+    }
+    for (int k = t; k < t + cost; ++k) {
+      ++load[k];
+    }
+    t += cost;
+  }
+  return;
+}
+
+void
+Model::schedule_departure()
+{
+  PROFILE_PHASE("schedule_departure");
+
+  // NOTE: preset cars are fixed, they are the background load.
+  if (!this->preset_load_.empty()) {
+    this->road_load_ = this->preset_load_;
+  } else {
+    for (auto &st : this->cars_to_run_) {
+      if (st.is_preset != 0) {
+        this->commit_departure(st.speed, st.cross_index_seq, st.start_time);
+      }
+    }
+  }
+
+  {
+    PROFILE_PHASE("sort");
+    std::sort(this->cars_to_run_.begin(), this->cars_to_run_.end(),
+        [](const StartEndInfo &a, const StartEndInfo &b) -> bool {
+          return a.priority > b.priority ||
+                 (a.priority == b.priority && a.start_time < b.start_time) ||
+                 (a.priority == b.priority && a.start_time == b.start_time && a.estimate_cost_time < b.estimate_cost_time);
+        });
+  }
+
+  // NOTE: not cut by the budget, a plan in progress is finished with the
+  //       capacity check, only the next plans are not started.
+  for (auto &st : this->cars_to_run_) {
+    if (st.is_preset != 0) {
+      continue;
+    }
+    st.start_time = this->find_departure_time(st.speed, st.cross_index_seq, st.start_time);
+    this->commit_departure(st.speed, st.cross_index_seq, st.start_time);
+  }
+
+  return;
+}
+/*}}}*/
 
 // compute hotspot with classical shortest path.
 void
 Model::compute_hotspot()
 {
-  static auto cmp = [](const NodeInfo &a, const NodeInfo &b) -> bool {
-    return a.cost_time > b.cost_time;
-  };
+  PROFILE_PHASE("compute_hotspot");
 
-  static auto cost_func = [](const StartEndInfo &st, const RoadInfo &r, const NodeInfo &n) -> int {
-    int len   = r.len;
-    int limit = r.speed;
-    int min_v = std::min(st.speed, limit);
-    return (len + min_v - 1) / min_v;
-  };
+  // NOTE: all commodities are routed at once (in parallel), the first route is the shortest.
+  this->aggregate_demand();
+  this->path_engine_.reset(new PathEngine(this->network_, this->path_k_, this->path_overlap_, this->threads_));
+  if (!this->delay_factor_.empty()) {
+    this->path_engine_->set_base_factor(this->edge_factor_);
+  }
+  this->path_engine_->set_stop(this->watchdog_ ? &this->watchdog_->stop() : nullptr);
+  for (auto &cm : this->commodities_) {
+    this->path_engine_->request(cm.from_index, cm.to_index, cm.speed);
+  }
+  this->path_engine_->generate();
+
+  std::vector<int> speeds;
+  for (auto &cm : this->commodities_) {
+    speeds.push_back(cm.speed);
+  }
+  this->travel_time_.reset(new TravelTimeTable(this->network_, speeds, this->apsp_max_bytes_, this->threads_));
 
   for (auto &st : this->cars_to_run_) {
     if (st.is_preset != 0) {
-      // NOTE: for preset car or non-preset car, compute hotspot separately.
-      st.estimate_cost_time = this->compute_estimate_cost(st.speed, st.cross_index_seq);
-      for (auto idx : st.cross_index_seq) {
-        ++(this->node_info_[idx].hotspot);
-      }
-    } else {
-      Feedback fb = this->dijkstra(st, cmp, cost_func);
-      st.estimate_cost_time = fb.cost_time;
-      for (auto idx : fb.t_path) {
-        ++(this->node_info_[idx].hotspot);
+      // NOTE: for preset car or non-preset car, estimate separately.
+      st.estimate_cost_time = this->compute_estimate_cost(st.speed, st.cross_index_seq, st.start_time);
+    }
+  }
+
+  for (auto &cm : this->commodities_) {
+    const std::vector<Route> &routes = this->path_engine_->get(cm.from_index, cm.to_index, cm.speed);
+    if (routes.empty() || routes.front().edges.empty()) {
+      // XXX: no road to the destination, such cars are left out of the answers.
+      for (auto i : cm.cars) {
+        std::cout << "unreachable car " << this->cars_to_run_[i].id << ", not in the answers" << std::endl;
       }
+      continue;
+    }
+    const Route &r = routes.front();
+    int cost = this->travel_time_->distance(cm.from_index, cm.to_index, cm.speed);
+    for (auto i : cm.cars) {
+      this->cars_to_run_[i].estimate_cost_time = (cost >= 0) ? cost : r.cost;
     }
   }
 
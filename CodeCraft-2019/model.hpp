@@ -9,88 +9,31 @@
 #define _MODEL_HPP_
 
 #include <iostream>
+#include <cmath>      // std::ceil
 
-#include <map> 
 #include <vector>
-#include <unordered_map>
+#include <memory>     // std::unique_ptr
+#include <thread>     // std::thread::hardware_concurrency
 #include <functional> // std::function
 #include <utility>    // std::pair
 
 // #include <ctime>      // std::time
 // #include <cstdlib>    // std::rand, std::srand
 
-#include "io.hpp"
-
-/*{{{ DEFINE MACRO */
-#define   CAR_ID                  0
-#define   CAR_FROM                1
-#define   CAR_TO                  2
-#define   CAR_SPEED               3
-#define   CAR_PLAN_TIME           4
-#define   CAR_PRIORITY            5
-#define   CAR_PRESET              6
-#define   CAR_SIZE                7
-
-#define   ROAD_ID                 0
-#define   ROAD_LEN                1
-#define   ROAD_SPEED              2
-#define   ROAD_CHANNEL            3
-#define   ROAD_FROM               4
-#define   ROAD_TO                 5
-#define   ROAD_IS_DUPLEX          6
-#define   ROAD_SIZE               7
-
-#define   CROSS_ID                0
-#define   CROSS_UP                1
-#define   CROSS_RIGHT             2
-#define   CROSS_DOWN              3
-#define   CROSS_LEFT              4
-#define   CROSS_SIZE              5
-
-#define   PRESET_CAR_ID           0
-#define   PRESET_CAR_START_TIME   1
-#define   PRESET_CAR_ROAD_START   2
-/*}}}*/
-
-/*{{{ RawCar, RawRoad, RawCross, RawPresetCar. (up to the input data) */
-struct RawCar {
-  RawCar(int i, int f, int t, int s, int pt, int prr, int prs)
-    : id(i), from(f), to(t), speed(s), plan_time(pt), priority(prr), preset(prs) {}
-  int id, from, to, speed, plan_time, priority, preset;
-};
-
-struct RawRoad {
-  RawRoad(int i, int l, int s, int c, int f, int t, int b)
-    : id(i), len(l), speed(s), channel(c), from(f), to(t), is_duplex(b) {}
-  int id, len, speed, channel, from, to, is_duplex;
-};
-
-struct RawCross {
-  RawCross(int i, int up, int right, int down, int left)
-    : id(i), r1(up), r2(right), r3(down), r4(left) {}
-  int id, r1, r2, r3, r4;
-};
-
-// FIXME: ?constructor
-struct RawPresetCar {
-  RawPresetCar(int i, int s, std::vector<int> v)
-    : id(i), start_time(s), road_path(v) {}
-  int id, start_time;
-  std::vector<int> road_path;
-};
-/*}}}*/
+#include "network.hpp"
+#include "path_engine.hpp"
+#include "equilibrium.hpp"
+#include "apsp.hpp"
+#include "watchdog.hpp"
+#include "preset_profile.hpp"
+#include "cosim.hpp"
+#include "profile.hpp"
 
-/*{{{ struct: Feedback, StartEndInfo, NodeInfo, RoadInfo */
+/*{{{ struct: StartEndInfo, Commodity, NodeInfo, RoadInfo */
 /*
  * FIXME: may add more detail information and constructor. 
  *        DO NOT modify current symbol.
  */
-struct Feedback {
-  // int start_time, sugeest_start_time;
-  std::vector<int> t_path;
-  int cost_time;
-};
-
 struct StartEndInfo {
   StartEndInfo(int i, int st, int f, int t, int sp, int p, int b)
     : id(i)
@@ -99,15 +42,22 @@ struct StartEndInfo {
     , to_index(t)
     , speed(sp)
     , priority(p)
-    , is_preset(b) {}
+    , is_preset(b)
+    , estimate_cost_time(0) {}
   int id, start_time, from_index, to_index, speed, priority, is_preset;
 
   // NOTE: after initiating and compute_hotspot.
   int estimate_cost_time;
   std::vector<int> cross_index_seq;
+};
 
-  // TODO:
-  int hot = 0;
+// NOTE: the non-preset cars sharing (from_index, to_index, speed), routed once.
+//   -- cars: index of cars_to_run_ (before departure scheduling reorders it).
+struct Commodity {
+  Commodity(int f, int t, int sp)
+    : from_index(f), to_index(t), speed(sp) {}
+  int from_index, to_index, speed;
+  std::vector<int> cars;
 };
 
 // FIXME: considering...
@@ -124,29 +74,40 @@ struct NodeInfo {
 };
 
 // FIXME: ??
+//   -- index: the directed road index, used by the departure scheduler.
+//   -- volumn: cars routed over the directed road.
 struct RoadInfo {
   int id, len, speed, channel;
+  int index;
+  int volumn;
 };
 /*}}}*/
 
+// NOTE: how the cars of a commodity are spread over routes.
+//   -- ROUTING_SPLIT:       alternative routes in proportion to their residual capacity.
+//   -- ROUTING_EQUILIBRIUM: MSA user equilibrium over BPR link delays.
+//   -- ROUTING_ONLINE:      the equilibrium plan, then every car routed again at
+//                           its start tick while co-simulating with the judge.
+enum RoutingMode {
+  ROUTING_SPLIT       = 0,
+  ROUTING_EQUILIBRIUM = 1,
+  ROUTING_ONLINE      = 2
+};
+
 class Model {
 public:
   Model(const std::string &car_path,
         const std::string &road_path,
         const std::string &cross_path,
         const std::string &preset_path,
-        const std::string &answer_path);
+        const std::string &answer_path,
+        const bool renumber = false);
 
   ~Model() {}
 
   // NOTE: after constructing.. map original id --> this model index.
   void initIndex();
 
-  // NOTE: based on dijkstra algorithm.
-  Feedback dijkstra(StartEndInfo &start_end,
-                    std::function<bool (const NodeInfo&, const NodeInfo&)> cmp,
-                    std::function<int (const StartEndInfo&, const RoadInfo&, const NodeInfo&)> cost);
-
   // XXX: require to design.  rate = start_time ^ 2 / all_car_require_time ?
   double time_rate(const int start_time, const int all_car_require_time);
 
@@ -165,21 +126,41 @@ public:
   // TODO: run model and store the answers.
   void run();
 
+  // NOTE: the solver stops refining when `watchdog` says so, nullptr runs to completion.
+  void set_watchdog(Watchdog *watchdog);
+
+  // NOTE: print the plans, the equilibrium iterations and the budget of each phase.
+  bool is_verbose() const;
+
+  // NOTE: release each non-preset car at the earliest tick (>= plan_time) where
+  //       no road on its route exceeds `road_capacity_rate_` of its capacity.
+  //   -- IN: cars_to_run_.cross_index_seq
+  //   -- EFFECT: cars_to_run_.start_time, road_load_.
+  //   -- the occupancy windows stay free-flow even with a delay table,
+  //      `road_capacity_rate_` is calibrated on them.
+  void schedule_departure();
+
   // XXX: @deprecated
   //   -- IN: latest_time_
   void make_logistics_like(std::vector<int> &time_sequences);
   void make_logistics_like();
 
+  // NOTE: override a parameter by name (from the command line), false if unknown
+  //       or out of range.
+  //   -- mode=split|equilibrium|online, capacity_rate=<double in (0, 1]>,
+  //      eq_iter=<int > 0>, eq_gap=<double >= 0>, eq_horizon=<int > 0>,
+  //      apsp_mb=<int in [0, 2^20]> (0 disables the all-pairs table), delay_table=<path>,
+  //      preset_profile=0|1, preset_cache=<dir> (empty: no cache),
+  //      online_weight=<double >= 0>, online_margin=<double >= 0>, verbose=0|1.
+  //   -- a value that is not a number as a whole is invalid, nothing is thrown.
+  bool set_parameter(const std::string &key, const std::string &value);
+
   // NOTE: output the answers stores in `this->answers_` (type: vector<vector<int>>).
   //   -- IN: output_path_, answers_
   void output_answers();
 
 private:
   Model() = default;
-  void transform_raw_data(const std::vector<std::vector<int>> &cars,
-                          const std::vector<std::vector<int>> &roads,
-                          const std::vector<std::vector<int>> &crosses,
-                          const std::vector<std::vector<int>> &preset_cars);
 
   // NOTE: transform src_id, road_path_id, tgt_id --> node index sequence.
   std::vector<int> transform_original_path_to_cross_index(const int from_id, const std::vector<int> &roads, const int to_id);
@@ -187,43 +168,58 @@ private:
   // NOTE: the number of crosses.
   int size_;
 
-  // NOTE: the raw data of the model NOT input data.
-  std::vector<RawCar>       raw_cars_;
-  std::vector<RawRoad>      raw_roads_;
-  std::vector<RawCross>     raw_crosses_;
-  std::vector<RawPresetCar> raw_preset_cars_;
+  // NOTE: the number of directed roads.
+  int edge_size_;
+
+  // NOTE: the road network parsed from input data, with dense indices.
+  Network network_;
   /************************************************/
 
-  // NOTE: extracted info. from raw data after calling `initIndex()`.
-  std::map<int, int>                      cross_id_to_index_;
-  std::map<std::pair<int, int>, RoadInfo> cross_index_to_road_info_;
-  std::vector<std::vector<int>>           adjacency_;
+  // NOTE: extracted info. from network_ after calling `initIndex()`.
+  //   -- road_info_: directed road index --> RoadInfo.
+  std::vector<RoadInfo>                   road_info_;
   std::vector<NodeInfo>                   node_info_;
   std::vector<StartEndInfo>               cars_to_run_;
-  std::map<int, std::pair<int, int>>      road_id_to_cross_index_;
-  std::unordered_map<int, int>            preset_car_id_to_index_;
-  std::map<int, std::map<int, int>>       from_road_id_to_to_id_;
   /****************************************************************/
 
   // NOTE:
-  //   -- IN: adjacency_
+  //   -- IN: network_
   //   -- EFFECT: node_info_ will be modified.
   //              store the in-degree and out-degree for each node.
   void record_node_degree();
 
   // NOTE: parameter of thie model.
   void   default_parameter();
-  bool   (*priority_cmp) (const NodeInfo&, const NodeInfo&);
-  int    (*cost_func)    (const StartEndInfo&, const RoadInfo&, const NodeInfo&);
   int    latest_time_;
-  int    start_time_;
 
   // XXX: @deprecated.
   // int    (*random_call)(int i);
 
-  // TODO: first schedule rate recommend 0.3
-  double first_schedule_rate_;
-  double first_schedule_time_rate_;
+  // NOTE: the fraction of `len * channel` a road may be loaded to, in (0, 1]. recommend 0.12
+  double road_capacity_rate_;
+
+  // NOTE: alternative routes per (from, to, speed), and their max shared length.
+  int    path_k_;
+  double path_overlap_;
+  int    threads_;
+
+  // NOTE: how much the cars already routed through a cross shrink a route's capacity.
+  double route_volumn_weight_;
+
+  // NOTE: equilibrium routing, stop at `eq_gap_` relative gap or `eq_max_iter_` iterations.
+  //   -- eq_horizon_: ticks over which a road's capacity is counted.
+  RoutingMode routing_mode_;
+  int         eq_max_iter_;
+  double      eq_gap_;
+  int         eq_horizon_;
+
+  // NOTE: online routing, the weight of the live road load (cars per `len * channel`),
+  //       and how much faster a new route must be to replace the planned one.
+  double      online_weight_;
+  double      online_margin_;
+
+  // NOTE: memory cap of the all-pairs travel time table, larger maps search on demand.
+  std::size_t apsp_max_bytes_;
 
   // XXX: @deprecated
   double mid_point_;
@@ -231,22 +227,79 @@ private:
   double upper_hotspot_cut_;       // recommend > 0.7 (<1)
   /*****************************************************************************/
 
-  // NOTE: compute the time cost.
-  int compute_estimate_cost(const int speed, const std::vector<int> &cross_idx);
-
-  // NOTE: compute hot spot and record estimate time for each car.
-  //   -- EFFECT: hotest_spot_cross_index_, cars_to_run_.estimate_cost_time, node_info_.hotspot.
+  // NOTE: compute the time cost of a route entered at `start_time`.
+  int compute_estimate_cost(const int speed, const std::vector<int> &cross_idx, const int start_time = 0);
+
+  // NOTE: ticks to pass directed road `e` entered at tick `t`, free flow unless a
+  //       delay table is loaded.
+  int edge_delay(const int e, const int speed, const int t) const;
+
+  // NOTE: load the judge's road delay table (see DELAY_* in network.hpp).
+  //   -- EFFECT: delay_factor_, edge_factor_, delay_bucket_.
+  bool load_delay_table(const std::string &path);
+
+  // NOTE: observed delay / free-flow time, directed road -> per entry bucket
+  //       (0 if too few samples), and over all buckets.
+  std::vector<std::vector<double>> delay_factor_;
+  std::vector<double>              edge_factor_;
+  int                              delay_bucket_;
+
+  // NOTE: the preset cars simulated alone replace their free-flow windows in
+  //       the departure scheduler, see PresetProfile. off by default,
+  //       `road_capacity_rate_` is calibrated on the free-flow windows.
+  //   -- preset_load_: directed road -> { preset cars on road at tick 0, 1, ... }
+  bool                             use_preset_profile_;
+  std::string                      preset_cache_;
+  PresetProfile                    preset_profile_;
+  std::vector<std::vector<int>>    preset_load_;
+  void load_preset_profile();
+
+  // NOTE: route the commodities and record estimate time for each car.
+  //   -- EFFECT: cars_to_run_.estimate_cost_time.
   void compute_hotspot();
 
-  // NOTE: compute passby cars for each cross id.
-  //   -- IN: cars_to_run_;
-  //      OUT: cross_index_to_passby_cars_.
-  void compute_passby_cars();
+  // NOTE: K alternative routes per OD pair, filled by compute_hotspot().
+  std::unique_ptr<PathEngine> path_engine_;
+
+  // NOTE: free-flow travel time between any two crosses, built by compute_hotspot().
+  std::unique_ptr<TravelTimeTable> travel_time_;
+
+  // NOTE: group non-preset cars into commodities.
+  //   -- IN: cars_to_run_
+  //   -- EFFECT: commodities_.
+  std::vector<Commodity> commodities_;
+  void aggregate_demand();
+
+  // NOTE: split the cars of each commodity across its alternative routes,
+  //       in proportion to the route capacity.
+  //   -- IN: commodities_, path_engine_
+  //   -- EFFECT: cars_to_run_.cross_index_seq, road_info_.volumn.
+  void assign_routes();
 
-  // TODO: must after compute_passby_cars()
-  //   -- IN: hotest_spot_cross_index_, cars_to_run_
-  //   -- compute each cars hot. sum of all cross index passby cars.
-  void compute_cars_hot();
+  // NOTE: every car of a commodity takes its shortest route.
+  //   -- EFFECT: cars_to_run_.cross_index_seq, road_info_.volumn.
+  void assign_shortest();
+
+  // NOTE: route the commodities to user equilibrium, then split by path flow.
+  //   -- IN: commodities_, path_engine_
+  //   -- EFFECT: cars_to_run_.cross_index_seq, road_info_.volumn.
+  void assign_equilibrium();
+
+  // NOTE: the residual capacity of a route, given `routed` cars so far.
+  double route_capacity(const Route &r, const double routed);
+
+  // NOTE: load of a directed road, routed cars per `len * channel` slot.
+  double road_load(const int e) const;
+
+  // NOTE: add `n` cars to the volumn of each directed road along the cross sequence.
+  void add_road_volumn(const std::vector<int> &cross_idx, const int n);
+
+  // NOTE: the number of `len * channel` slots of all directed roads.
+  double total_slots_;
+
+  // NOTE: deal the cars of a commodity to routes in proportion to `share`.
+  //   -- EFFECT: cars_to_run_.cross_index_seq, road_info_.volumn.
+  void deal_cars(const Commodity &cm, const std::vector<Route> &routes, const std::vector<double> &share);
 
   // XXX: @deprecated
   // int lower_bound_hotspot_;
@@ -255,12 +308,53 @@ private:
   // XXX: the most frequent pass-by cross index.
   // int hotest_spot_cross_index_;
 
-  // NOTE: cross idx -> { car_index, ... }
-  std::vector<std::vector<int>> cross_index_to_passby_cars_;
+  // NOTE: projected load, directed road index -> { cars on road at tick 0, 1, ... }
+  std::vector<std::vector<int>> road_load_;
+
+  // NOTE: the earliest tick >= `earliest` to release the route without overload.
+  int  find_departure_time(const int speed, const std::vector<int> &cross_idx, const int earliest);
+  void commit_departure(const int speed, const std::vector<int> &cross_idx, const int start_time);
+
+  // NOTE: route with `assign`, schedule, and keep the plan if its estimate beats
+  //       the best. it becomes the answers when the judge finishes it earlier
+  //       than the answers.
+  //   -- IN: cars_to_run_ (unrouted, unscheduled)
+  //   -- EFFECT: plan_, best_score_, answers_, answer_score_, is_accepted_.
+  void make_plan(const char *name, std::function<void ()> assign);
+
+  // NOTE: run the answer lines through the judge engine in process, false on
+  //       deadlock. not cut by the budget, the plan is already made.
+  //   -- OUT: score, (schedule time, all schedule time) as the judge reports.
+  bool judge_plan(const std::vector<std::vector<int>> &plan, std::pair<long long, long long> &score);
+
+  // NOTE: co-simulate the best plan with every car routed again at its start
+  //       tick, keep the answers that judge better.
+  //   -- IN: plan_, answers_
+  //   -- EFFECT: answers_, answer_score_, is_accepted_.
+  void make_online_plan();
+
+  // NOTE: the input, for the engines that read it again.
+  std::string car_path_, road_path_, cross_path_, preset_path_;
+  bool        renumber_;
+
+  // NOTE: wall-clock budget, may be nullptr.
+  Watchdog *watchdog_;
+  bool      verbose_;
+  bool is_stopped() const;
+  void log_budget(const char *phase);
 
   // NOTE: set the output path, and store answer in this class.
+  //   -- plan_, best_score_: the plan of the best (estimated makespan, total
+  //      arrive time), refined by the online mode.
+  //   -- answers_, answer_score_: the lines written, and (schedule time, all
+  //      schedule time) the judge gives them if `is_accepted_` (no deadlock).
+  //      an unreachable car has no line.
   std::string                             output_path_;
+  std::vector<std::vector<int>>           plan_;
+  std::pair<long long, long long>         best_score_;
   std::vector<std::vector<int>>           answers_;
+  std::pair<long long, long long>         answer_score_;
+  bool                                    is_accepted_;
   /***********************************************************/
 };
 
@@ -269,21 +363,22 @@ Model::Model(const std::string &car_path,
              const std::string &road_path,
              const std::string &cross_path,
              const std::string &preset_path,
-             const std::string &answer_path)
+             const std::string &answer_path,
+             const bool renumber)
+  : network_(car_path, road_path, cross_path, preset_path, renumber)
+  , delay_bucket_(1)
+  , preset_profile_(car_path, road_path, cross_path, preset_path)
+  , car_path_(car_path)
+  , road_path_(road_path)
+  , cross_path_(cross_path)
+  , preset_path_(preset_path)
+  , renumber_(renumber)
+  , watchdog_(nullptr)
+  , is_accepted_(false)
 {
   // XXX: 
   this->default_parameter();
 
-  std::vector<std::vector<int>> cars, roads, crosses, preset_cars;
-  read_from_file(car_path, CAR_SIZE, cars);
-  read_from_file(road_path, ROAD_SIZE, roads);
-  read_from_file(cross_path, CROSS_SIZE, crosses);
-
-  read_from_file(preset_path, preset_cars);
-
-  // XXX: process preset_cars;
-  this->transform_raw_data(cars, roads, crosses, preset_cars);
-
   this->initIndex();
 
   this->record_node_degree();
@@ -295,10 +390,22 @@ Model::Model(const std::string &car_path,
 inline void
 Model::default_parameter()
 {
-  this->start_time_               = 600;
-  this->latest_time_              = 2600;
-  this->first_schedule_rate_      = 0.3;
-  this->first_schedule_time_rate_ = 0.5;
+  this->latest_time_         = 2600;
+  this->road_capacity_rate_  = 0.12;
+  this->path_k_              = 4;
+  this->path_overlap_        = 0.7;
+  this->route_volumn_weight_ = 10.0;
+  this->routing_mode_        = ROUTING_ONLINE;
+  this->eq_max_iter_         = 50;
+  this->eq_gap_              = 0.01;
+  this->eq_horizon_          = 100;
+  this->online_weight_       = 10.0;
+  this->online_margin_       = 0.2;
+  this->apsp_max_bytes_      = 256u << 20;
+  this->use_preset_profile_  = false;
+  this->preset_cache_        = "/tmp";
+  this->threads_             = std::max(1u, std::thread::hardware_concurrency());
+  this->verbose_             = false;
 
   // FIXME: not use?
   this->mid_point_ = 0.3;
@@ -308,23 +415,6 @@ Model::default_parameter()
    * double upper_hotspot_cut_ = 0.7 ;
    */
 
-  // `true` means first element `a` is weaker priority order than second element `b`,
-  // otherwise first element `a` is more priority than second element `b`.
-  this->priority_cmp = [](const NodeInfo &a, const NodeInfo &b) -> bool {
-    return a.cost_time > b.cost_time ||
-          (a.cost_time <= b.cost_time && a.hotspot > b.hotspot);
-  };
-
-  // cost function to computer src to current node. (must return > 0)
-  this->cost_func = [](const StartEndInfo &st, const RoadInfo &r, const NodeInfo &n) -> int {
-    int len   = r.len;
-    int limit = r.speed;
-    int min_v = std::min(st.speed, limit);
-    return (len + min_v - 1) / min_v;
-    // return (int) (n.hotspot * (rand() / (double) RAND_MAX));
-    // return n.hotspot + n.volumn;
-  };
-
   // XXX: set time seed?
   // std::srand(std::time(0));
   // this->random_call = [](int i) -> int { return std::rand() % i; };
@@ -339,12 +429,11 @@ Model::transform_original_path_to_cross_index(const int from_id,
                                               const int to_id)
 {
   std::vector<int> ret;
-  int from = from_id, to;
-  ret.push_back(this->cross_id_to_index_[from]);
+  int from = this->network_.cross_index(from_id);
+  ret.push_back(from);
   for (auto rd : roads) {
-    to = this->from_road_id_to_to_id_[from][rd];
-    ret.push_back(this->cross_id_to_index_[to]);
-    from = to;
+    from = this->network_.other_end(this->network_.road_index(rd), from);
+    ret.push_back(from);
   }
   // FIXME: assert end_to == to_id;
   return ret;
@@ -352,42 +441,49 @@ Model::transform_original_path_to_cross_index(const int from_id,
 
 inline int
 Model::compute_estimate_cost(const int speed,
-                             const std::vector<int> &cross_idx)
+                             const std::vector<int> &cross_idx,
+                             const int start_time)
 {
-  int ret = 0, len, limit, min_v;
+  int t  = start_time;
   int sz = cross_idx.size();
   for (int i = 1; i < sz; ++i) {
-    RoadInfo rinfo = this->cross_index_to_road_info_[{ cross_idx[i - 1], cross_idx[i] }];
-    len   = rinfo.len;
-    limit = rinfo.speed;
-    min_v = std::min(speed, limit);
-    ret  += (int) ((len + min_v - 1) / min_v);
+    t += this->edge_delay(this->network_.edge_between(cross_idx[i - 1], cross_idx[i]), speed, t);
   }
-  return ret;
+  return t - start_time;
 }
 
-// XXX: emm...
-inline void
-Model::compute_passby_cars()
+inline int
+Model::edge_delay(const int e,
+                  const int speed,
+                  const int t)
+  const
 {
-  int sz = this->cars_to_run_.size();
-  for (auto i = 0; i < sz; ++i) {
-    for (auto &idx : this->cars_to_run_[i].cross_index_seq) {
-      this->cross_index_to_passby_cars_[idx].push_back(i);
-    }
+  int cost = this->network_.travel_time(e, speed);
+  if (this->delay_factor_.empty()) {
+    return cost;
   }
-  return;
+
+  const std::vector<double> &f = this->delay_factor_[e];
+  int b = std::max(0, t) / this->delay_bucket_;
+  double factor = (b < (int) f.size() && f[b] > 0.0) ? f[b] : this->edge_factor_[e];
+  return (int) std::ceil(cost * factor);
+}
+
+inline double
+Model::road_load(const int e)
+  const
+{
+  const RoadInfo &r = this->road_info_[e];
+  return (double) r.volumn / (r.len * r.channel);
 }
 
-// XXX: emmm...
 inline void
-Model::compute_cars_hot()
+Model::add_road_volumn(const std::vector<int> &cross_idx,
+                       const int n)
 {
-  for (auto &st : this->cars_to_run_) {
-    for (auto &idx : st.cross_index_seq) {
-      // st.hot += this->cross_index_to_passby_cars_[idx].size();
-      st.hot += this->node_info_[idx].volumn;
-    }
+  int sz = cross_idx.size();
+  for (auto i = 1; i < sz; ++i) {
+    this->road_info_[this->network_.edge_between(cross_idx[i - 1], cross_idx[i])].volumn += n;
   }
   return;
 }
@@ -397,56 +493,15 @@ inline void
 Model::record_node_degree()
 {
   for (auto i = 0; i < this->size_; ++i) {
-    this->node_info_[i].out_degree = this->adjacency_[i].size();
-    for (auto n : this->adjacency_[i]) {
-      ++(this->node_info_[n].in_degree);
+    this->node_info_[i].out_degree = this->network_.out_end(i) - this->network_.out_begin(i);
+    for (auto e = this->network_.out_begin(i); e != this->network_.out_end(i); ++e) {
+      ++(this->node_info_[this->network_.edge_to(*e)].in_degree);
     }
   }
 
   return;
 }
 
-inline void
-Model::transform_raw_data(const std::vector<std::vector<int>> &cars,
-                          const std::vector<std::vector<int>> &roads,
-                          const std::vector<std::vector<int>> &crosses,
-                          const std::vector<std::vector<int>> &preset_cars)
-{
-  this->raw_cars_.reserve(cars.size());
-  this->raw_roads_.reserve(roads.size());
-  this->raw_crosses_.reserve(crosses.size());
-
-  // TODO: obtain information and transform into raw_***s_.
-  for (auto &v : cars) {
-    this->raw_cars_.push_back(
-        RawCar(v[CAR_ID], v[CAR_FROM], v[CAR_TO], v[CAR_SPEED], v[CAR_PLAN_TIME],
-               v[CAR_PRIORITY], v[CAR_PRESET])
-        );
-  }
-
-  for (auto &v : roads) {
-    this->raw_roads_.push_back(
-        RawRoad(v[ROAD_ID], v[ROAD_LEN], v[ROAD_SPEED], v[ROAD_CHANNEL],
-                v[ROAD_FROM], v[ROAD_TO], v[ROAD_IS_DUPLEX])
-        );
-  }
-
-  for (auto &v : crosses) {
-    this->raw_crosses_.push_back(
-        RawCross(v[CROSS_ID], v[CROSS_UP], v[CROSS_RIGHT], v[CROSS_DOWN], v[CROSS_LEFT])
-        );
-  }
-
-  for (auto &v : preset_cars) {
-    this->raw_preset_cars_.push_back(
-        RawPresetCar(v[PRESET_CAR_ID], v[PRESET_CAR_START_TIME],
-                     std::vector<int>(v.begin() + PRESET_CAR_ROAD_START, v.end()))
-        );
-  }
-
-  return;
-}
-
 // FIXME: not useful?
 inline void
 Model::increase_volumn(std::vector<int> &nodes)
@@ -462,14 +517,45 @@ Model::transform_path(std::vector<int> &nodes) {
   std::vector<int> road_path;
   int sz = nodes.size();
   for (auto i = 1; i < sz; ++i) {
-    road_path.push_back(this->cross_index_to_road_info_[{ nodes[i - 1], nodes[i] }].id);
+    road_path.push_back(this->road_info_[this->network_.edge_between(nodes[i - 1], nodes[i])].id);
   }
   return road_path;
 }
 
+inline void
+Model::set_watchdog(Watchdog *watchdog)
+{
+  this->watchdog_ = watchdog;
+  return;
+}
+
+inline bool
+Model::is_verbose()
+  const
+{
+  return this->verbose_;
+}
+
+inline bool
+Model::is_stopped()
+  const
+{
+  return this->watchdog_ != nullptr && this->watchdog_->is_stopped();
+}
+
+inline void
+Model::log_budget(const char *phase)
+{
+  if (this->watchdog_ != nullptr) {
+    this->watchdog_->log(phase);
+  }
+  return;
+}
+
 inline void
 Model::output_answers()
 {
+  PROFILE_PHASE("output_answers");
   write_to_file(this->output_path_, this->answers_);
   return;
 }
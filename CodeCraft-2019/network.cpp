@@ -0,0 +1,315 @@
+/*
+ * network.cpp
+ * Copyright (C) 2019 Guowei Chen <icgw@outlook.com>
+ *
+ * Distributed under terms of the GPL license.
+ */
+
+#include <algorithm> // std::sort, std::min_element, std::max_element, std::reverse
+
+#include <utility>   // std::pair
+
+#include "network.hpp"
+#include "profile.hpp"
+
+void
+IdIndex::build(const std::vector<int> &ids)
+{
+  this->index_.clear();
+  this->sorted_.clear();
+  if (ids.empty()) {
+    return;
+  }
+
+  this->base_    = *std::min_element(ids.begin(), ids.end());
+  int top        = *std::max_element(ids.begin(), ids.end());
+  long long span = (long long) top - this->base_ + 1;
+
+  // NOTE: sparse ids, binary search instead of a table mostly -1.
+  const int sparse = 4;
+  int sz = ids.size();
+  if (span > (long long) sparse * sz) {
+    this->sorted_.reserve(sz);
+    for (auto i = 0; i < sz; ++i) {
+      this->sorted_.push_back(std::make_pair(ids[i], i));
+    }
+    std::sort(this->sorted_.begin(), this->sorted_.end());
+    return;
+  }
+
+  this->index_.assign(span, -1);
+  for (auto i = 0; i < sz; ++i) {
+    this->index_[ids[i] - this->base_] = i;
+  }
+  return;
+}
+
+Network::Network(const std::string &car_path,
+                 const std::string &road_path,
+                 const std::string &cross_path,
+                 const std::string &preset_path,
+                 const bool renumber)
+{
+  std::vector<std::vector<int>> cars, roads, crosses, preset_cars;
+  {
+    PROFILE_PHASE("parse");
+    read_from_file(car_path, CAR_SIZE, cars);
+    read_from_file(road_path, ROAD_SIZE, roads);
+    read_from_file(cross_path, CROSS_SIZE, crosses);
+
+    read_from_file(preset_path, preset_cars);
+  }
+
+  this->transform_raw_data(cars, roads, crosses, preset_cars);
+
+  this->init_index();
+
+  if (renumber) {
+    this->renumber();
+  }
+}
+
+void
+Network::transform_raw_data(const std::vector<std::vector<int>> &cars,
+                            const std::vector<std::vector<int>> &roads,
+                            const std::vector<std::vector<int>> &crosses,
+                            const std::vector<std::vector<int>> &preset_cars)
+{
+  PROFILE_PHASE("transform_raw_data");
+
+  this->cars_.reserve(cars.size());
+  this->roads_.reserve(roads.size());
+  this->crosses_.reserve(crosses.size());
+  this->preset_cars_.reserve(preset_cars.size());
+
+  for (auto &v : cars) {
+    this->cars_.push_back(
+        RawCar(v[CAR_ID], v[CAR_FROM], v[CAR_TO], v[CAR_SPEED], v[CAR_PLAN_TIME],
+               v[CAR_PRIORITY], v[CAR_PRESET])
+        );
+  }
+
+  for (auto &v : roads) {
+    this->roads_.push_back(
+        RawRoad(v[ROAD_ID], v[ROAD_LEN], v[ROAD_SPEED], v[ROAD_CHANNEL],
+                v[ROAD_FROM], v[ROAD_TO], v[ROAD_IS_DUPLEX])
+        );
+  }
+
+  for (auto &v : crosses) {
+    this->crosses_.push_back(
+        RawCross(v[CROSS_ID], v[CROSS_UP], v[CROSS_RIGHT], v[CROSS_DOWN], v[CROSS_LEFT])
+        );
+  }
+
+  for (auto &v : preset_cars) {
+    this->preset_cars_.push_back(
+        RawPresetCar(v[PRESET_CAR_ID], v[PRESET_CAR_START_TIME],
+                     std::vector<int>(v.begin() + PRESET_CAR_ROAD_START, v.end()))
+        );
+  }
+
+  // NOTE: the dense index follows the ascending original id.
+  std::sort(this->cars_.begin(), this->cars_.end(),
+      [](const RawCar &a, const RawCar &b) -> bool { return a.id < b.id; });
+  std::sort(this->roads_.begin(), this->roads_.end(),
+      [](const RawRoad &a, const RawRoad &b) -> bool { return a.id < b.id; });
+  std::sort(this->crosses_.begin(), this->crosses_.end(),
+      [](const RawCross &a, const RawCross &b) -> bool { return a.id < b.id; });
+
+  return;
+}
+
+void
+Network::init_index()
+{
+  PROFILE_PHASE("network_index");
+
+  std::vector<int> ids;
+
+  /*{{{ id --> index */
+  for (auto &c : this->crosses_) ids.push_back(c.id);
+  this->cross_id_to_index_.build(ids);
+
+  ids.clear();
+  for (auto &r : this->roads_) ids.push_back(r.id);
+  this->road_id_to_index_.build(ids);
+
+  ids.clear();
+  for (auto &c : this->cars_) ids.push_back(c.id);
+  this->car_id_to_index_.build(ids);
+  /*}}}*/
+
+  /*{{{ road --> (from, to), cross --> roads, car --> (from, to) */
+  int sz = this->roads_.size();
+  this->road_from_.resize(sz);
+  this->road_to_.resize(sz);
+  for (auto i = 0; i < sz; ++i) {
+    this->road_from_[i] = this->cross_index(this->roads_[i].from);
+    this->road_to_[i]   = this->cross_index(this->roads_[i].to);
+  }
+
+  sz = this->crosses_.size();
+  this->cross_road_.resize(sz * 4);
+  for (auto i = 0; i < sz; ++i) {
+    const RawCross &cs = this->crosses_[i];
+    int slots[4] = { cs.r1, cs.r2, cs.r3, cs.r4 };
+    for (auto k = 0; k < 4; ++k) {
+      this->cross_road_[i * 4 + k] = (slots[k] == -1) ? -1 : this->road_index(slots[k]);
+    }
+  }
+
+  sz = this->cars_.size();
+  this->car_from_.resize(sz);
+  this->car_to_.resize(sz);
+  this->preset_index_.assign(sz, -1);
+  for (auto i = 0; i < sz; ++i) {
+    this->car_from_[i] = this->cross_index(this->cars_[i].from);
+    this->car_to_[i]   = this->cross_index(this->cars_[i].to);
+  }
+
+  sz = this->preset_cars_.size();
+  for (auto i = 0; i < sz; ++i) {
+    int idx = this->car_index(this->preset_cars_[i].id);
+    if (idx >= 0) {
+      this->preset_index_[idx] = i;
+    }
+  }
+  /*}}}*/
+
+  /*{{{ compressed adjacency */
+  int cross_sz = this->crosses_.size();
+  int edge_sz  = this->edge_size();
+  this->out_offset_.assign(cross_sz + 1, 0);
+  for (auto e = 0; e < edge_sz; ++e) {
+    if (this->edge_valid(e)) {
+      ++this->out_offset_[this->edge_from(e) + 1];
+    }
+  }
+  for (auto c = 0; c < cross_sz; ++c) {
+    this->out_offset_[c + 1] += this->out_offset_[c];
+  }
+
+  this->out_edge_.resize(this->out_offset_[cross_sz]);
+  std::vector<int> fill(this->out_offset_.begin(), this->out_offset_.end() - 1);
+  for (auto e = 0; e < edge_sz; ++e) {
+    if (this->edge_valid(e)) {
+      this->out_edge_[fill[this->edge_from(e)]++] = e;
+    }
+  }
+  /*}}}*/
+
+  this->init_speed_class();
+  return;
+}
+
+void
+Network::init_speed_class()
+{
+  this->max_road_speed_ = 1;
+  for (auto &r : this->roads_) {
+    this->max_road_speed_ = std::max(this->max_road_speed_, r.speed);
+  }
+
+  this->speed_to_class_.assign(this->max_road_speed_ + 1, -1);
+  this->edge_time_.clear();
+  this->out_time_.clear();
+  for (auto &car : this->cars_) {
+    int v = std::min(car.speed, this->max_road_speed_);
+    if (v <= 0 || this->speed_to_class_[v] >= 0) {
+      continue;
+    }
+    this->speed_to_class_[v] = this->edge_time_.size();
+
+    int edge_sz = this->edge_size();
+    std::vector<int> ticks(edge_sz, 0);
+    for (auto e = 0; e < edge_sz; ++e) {
+      const RawRoad &r = this->roads_[e >> 1];
+      int min_v = std::min(v, r.speed);
+      ticks[e]  = (r.len + min_v - 1) / min_v;
+    }
+    std::vector<int> out(this->out_edge_.size());
+    int out_sz = out.size();
+    for (auto k = 0; k < out_sz; ++k) {
+      out[k] = ticks[this->out_edge_[k]];
+    }
+    this->edge_time_.push_back(ticks);
+    this->out_time_.push_back(out);
+  }
+  return;
+}
+
+// NOTE: reverse Cuthill-McKee over the undirected cross graph.
+//   -- BFS from an unvisited cross of minimum degree, neighbours by ascending degree.
+void
+Network::renumber()
+{
+  PROFILE_PHASE("renumber");
+
+  int sz = this->crosses_.size();
+  std::vector<int> degree(sz, 0);
+  for (auto c = 0; c < sz; ++c) {
+    for (auto k = 0; k < 4; ++k) {
+      degree[c] += this->cross_road(c, k) >= 0 ? 1 : 0;
+    }
+  }
+
+  std::vector<int> seeds(sz);
+  for (auto c = 0; c < sz; ++c) seeds[c] = c;
+  std::stable_sort(seeds.begin(), seeds.end(),
+      [&degree](const int a, const int b) -> bool { return degree[a] < degree[b]; });
+
+  std::vector<int>  order;
+  std::vector<bool> is_visited(sz, false);
+  order.reserve(sz);
+  for (auto s : seeds) {
+    if (is_visited[s]) {
+      continue;
+    }
+    is_visited[s] = true;
+    order.push_back(s);
+    for (auto head = order.size() - 1; head < order.size(); ++head) {
+      int u = order[head];
+      int nbr[4], n = 0;
+      for (auto k = 0; k < 4; ++k) {
+        int r = this->cross_road(u, k);
+        if (r >= 0 && !is_visited[this->other_end(r, u)]) {
+          nbr[n++] = this->other_end(r, u);
+          is_visited[nbr[n - 1]] = true;
+        }
+      }
+      std::stable_sort(nbr, nbr + n,
+          [&degree](const int a, const int b) -> bool { return degree[a] < degree[b]; });
+      order.insert(order.end(), nbr, nbr + n);
+    }
+  }
+  std::reverse(order.begin(), order.end());
+
+  /*{{{ permute crosses, then roads by (lower end, upper end) of the new index */
+  std::vector<int> new_index(sz);
+  std::vector<RawCross> crosses;
+  crosses.reserve(sz);
+  for (auto i = 0; i < sz; ++i) {
+    new_index[order[i]] = i;
+    crosses.push_back(this->crosses_[order[i]]);
+  }
+  this->crosses_.swap(crosses);
+
+  int road_sz = this->roads_.size();
+  std::vector<std::pair<long long, int>> key(road_sz);
+  for (auto r = 0; r < road_sz; ++r) {
+    long long a = new_index[this->road_from_[r]], b = new_index[this->road_to_[r]];
+    key[r] = std::make_pair(std::min(a, b) * sz + std::max(a, b), r);
+  }
+  std::sort(key.begin(), key.end());
+  std::vector<RawRoad> roads;
+  roads.reserve(road_sz);
+  for (auto &k : key) {
+    roads.push_back(this->roads_[k.second]);
+  }
+  this->roads_.swap(roads);
+  /*}}}*/
+
+  this->init_index();
+  return;
+}
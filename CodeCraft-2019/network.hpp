@@ -0,0 +1,399 @@
+/*
+ * network.hpp
+ * Copyright (C) 2019 Guowei Chen <icgw@outlook.com>
+ *
+ * Distributed under terms of the GPL license.
+ */
+
+#ifndef _NETWORK_HPP_
+#define _NETWORK_HPP_
+
+#include <algorithm> // std::lower_bound
+#include <string>
+#include <utility>   // std::pair
+#include <vector>
+
+#include "io.hpp"
+
+/*{{{ DEFINE MACRO */
+#define   CAR_ID                  0
+#define   CAR_FROM                1
+#define   CAR_TO                  2
+#define   CAR_SPEED               3
+#define   CAR_PLAN_TIME           4
+#define   CAR_PRIORITY            5
+#define   CAR_PRESET              6
+#define   CAR_SIZE                7
+
+#define   ROAD_ID                 0
+#define   ROAD_LEN                1
+#define   ROAD_SPEED              2
+#define   ROAD_CHANNEL            3
+#define   ROAD_FROM               4
+#define   ROAD_TO                 5
+#define   ROAD_IS_DUPLEX          6
+#define   ROAD_SIZE               7
+
+#define   CROSS_ID                0
+#define   CROSS_UP                1
+#define   CROSS_RIGHT             2
+#define   CROSS_DOWN              3
+#define   CROSS_LEFT              4
+#define   CROSS_SIZE              5
+
+#define   PRESET_CAR_ID           0
+#define   PRESET_CAR_START_TIME   1
+#define   PRESET_CAR_ROAD_START   2
+
+// NOTE: one row of the road delay table, exported by the judge.
+//   -- (road id, start cross id, bucket start tick, bucket ticks, cars, sum of delay, sum of free-flow time)
+#define   DELAY_ROAD_ID           0
+#define   DELAY_FROM              1
+#define   DELAY_BUCKET_START      2
+#define   DELAY_BUCKET_LEN        3
+#define   DELAY_COUNT             4
+#define   DELAY_SUM               5
+#define   DELAY_FREE_SUM          6
+#define   DELAY_SIZE              7
+
+// NOTE: one row of the preset occupancy profile, cars on a directed road at a tick.
+//   -- (road id, start cross id, tick, cars)
+#define   OCCUPANCY_ROAD_ID       0
+#define   OCCUPANCY_FROM          1
+#define   OCCUPANCY_TICK          2
+#define   OCCUPANCY_CARS          3
+#define   OCCUPANCY_SIZE          4
+/*}}}*/
+
+/*{{{ RawCar, RawRoad, RawCross, RawPresetCar. (up to the input data) */
+struct RawCar {
+  RawCar(int i, int f, int t, int s, int pt, int prr, int prs)
+    : id(i), from(f), to(t), speed(s), plan_time(pt), priority(prr), preset(prs) {}
+  int id, from, to, speed, plan_time, priority, preset;
+};
+
+struct RawRoad {
+  RawRoad(int i, int l, int s, int c, int f, int t, int b)
+    : id(i), len(l), speed(s), channel(c), from(f), to(t), is_duplex(b) {}
+  int id, len, speed, channel, from, to, is_duplex;
+};
+
+struct RawCross {
+  RawCross(int i, int up, int right, int down, int left)
+    : id(i), r1(up), r2(right), r3(down), r4(left) {}
+  int id, r1, r2, r3, r4;
+};
+
+// FIXME: ?constructor
+struct RawPresetCar {
+  RawPresetCar(int i, int s, std::vector<int> v)
+    : id(i), start_time(s), road_path(v) {}
+  int id, start_time;
+  std::vector<int> road_path;
+};
+/*}}}*/
+
+/*{{{ class IdIndex: original id --> dense index */
+// NOTE: direct-address table over [min_id, max_id] when the ids are compact,
+//       O(1). when the span exceeds 4 times the number of ids, a sorted
+//       (id, index) array searched in O(log n) instead, so one large id does
+//       not allocate a huge table.
+class IdIndex {
+public:
+  IdIndex() : base_(0) {}
+
+  void build(const std::vector<int> &ids);
+  int  operator()(const int id) const;
+
+private:
+  int              base_;
+  std::vector<int> index_;
+
+  std::vector<std::pair<int, int>> sorted_;
+};
+
+inline int
+IdIndex::operator()(const int id)
+  const
+{
+  if (!this->sorted_.empty()) {
+    auto it = std::lower_bound(this->sorted_.begin(), this->sorted_.end(), std::make_pair(id, -1));
+    return (it != this->sorted_.end() && it->first == id) ? it->second : -1;
+  }
+  unsigned k = (unsigned) id - (unsigned) this->base_;
+  return k < this->index_.size() ? this->index_[k] : -1;
+}
+/*}}}*/
+
+/*
+ * NOTE: the road network shared by the solver and the judge.
+ *   -- crosses, roads, cars are stored in flat arrays sorted by original id,
+ *      the position in the array is the dense index.
+ *   -- `renumber`: crosses follow the reverse Cuthill-McKee order and roads the
+ *      order of their lower end instead, so neighbours sit close in memory.
+ *      the ids are untouched, map back with `cross(c).id`, `road(r).id`.
+ *   -- directed road (edge) index: 2 * road_index + 0 (from -> to),
+ *                                  2 * road_index + 1 (to -> from, duplex only).
+ */
+class Network {
+public:
+  Network(const std::string &car_path,
+          const std::string &road_path,
+          const std::string &cross_path,
+          const std::string &preset_path,
+          const bool renumber = false);
+
+  int cross_size() const;
+  int road_size()  const;
+  int edge_size()  const;
+  int car_size()   const;
+
+  const RawCross&     cross(const int c)  const;
+  const RawRoad&      road(const int r)   const;
+  const RawCar&       car(const int i)    const;
+  const std::vector<RawPresetCar>& preset_cars() const;
+
+  // NOTE: original id --> dense index, -1 if unknown.
+  int cross_index(const int id) const;
+  int road_index(const int id)  const;
+  int car_index(const int id)   const;
+
+  // NOTE: car index --> index of `preset_cars()`, -1 if not preset.
+  int preset_index(const int i) const;
+
+  // NOTE: cross index of both ends of a road, and of the car's source and target.
+  int road_from(const int r) const;
+  int road_to(const int r)   const;
+  int car_from(const int i)  const;
+  int car_to(const int i)    const;
+
+  // NOTE: road index of the slot (0: up, 1: right, 2: down, 3: left) of a cross, -1 if none.
+  int cross_road(const int c, const int slot) const;
+
+  // NOTE: the other end of the road, seen from cross `c`.
+  int other_end(const int r, const int c) const;
+
+  // NOTE: the cross shared by two roads, -1 if they are not adjacent.
+  int shared_cross(const int r1, const int r2) const;
+
+  /*{{{ directed road */
+  bool edge_valid(const int e) const;
+  int  edge_road(const int e)  const;
+  int  edge_from(const int e)  const;
+  int  edge_to(const int e)    const;
+
+  // NOTE: the directed road leaving cross `c` along road `r`, -1 if not allowed.
+  int  edge_of(const int r, const int c) const;
+
+  // NOTE: the directed road from cross `u` to cross `v`, -1 if none.
+  int  edge_between(const int u, const int v) const;
+
+  // NOTE: directed roads leaving cross `c`, [out_begin, out_end).
+  const int* out_begin(const int c) const;
+  const int* out_end(const int c)   const;
+  /*}}}*/
+
+  /*{{{ free-flow travel time per speed class */
+  // NOTE: one class per distinct car speed (clamped to the fastest road), -1 if no car has it.
+  int speed_class(const int speed) const;
+  int speed_class_size() const;
+
+  // NOTE: ticks of directed road `e` at `speed`, a table load when the speed has a class.
+  int travel_time(const int e, const int speed) const;
+
+  // NOTE: the class table indexed by directed road.
+  const int* edge_time(const int cls) const;
+
+  // NOTE: the class table parallel to `out_begin(c)`, out_time(cls, c)[k] is the ticks of out_begin(c)[k].
+  const int* out_time(const int cls, const int c) const;
+  /*}}}*/
+
+private:
+  Network() = default;
+
+  void transform_raw_data(const std::vector<std::vector<int>> &cars,
+                          const std::vector<std::vector<int>> &roads,
+                          const std::vector<std::vector<int>> &crosses,
+                          const std::vector<std::vector<int>> &preset_cars);
+  void init_index();
+
+  // NOTE: permute crosses_ and roads_ for locality, then rebuild the index.
+  void renumber();
+
+  // NOTE: fill the per speed class tables, after the adjacency.
+  void init_speed_class();
+
+  std::vector<RawCar>       cars_;
+  std::vector<RawRoad>      roads_;
+  std::vector<RawCross>     crosses_;
+  std::vector<RawPresetCar> preset_cars_;
+
+  IdIndex cross_id_to_index_;
+  IdIndex road_id_to_index_;
+  IdIndex car_id_to_index_;
+
+  std::vector<int> preset_index_;
+  std::vector<int> road_from_, road_to_;
+  std::vector<int> car_from_, car_to_;
+  std::vector<int> cross_road_;
+
+  // NOTE: compressed adjacency of directed roads.
+  std::vector<int> out_offset_;
+  std::vector<int> out_edge_;
+
+  // NOTE: speed --> class, class --> ticks per directed road / per out-edge slot.
+  int                           max_road_speed_;
+  std::vector<int>              speed_to_class_;
+  std::vector<std::vector<int>> edge_time_;
+  std::vector<std::vector<int>> out_time_;
+};
+
+/*{{{ Network inline accessors */
+inline int Network::cross_size() const { return this->crosses_.size(); }
+inline int Network::road_size()  const { return this->roads_.size(); }
+inline int Network::edge_size()  const { return this->roads_.size() * 2; }
+inline int Network::car_size()   const { return this->cars_.size(); }
+
+inline const RawCross& Network::cross(const int c) const { return this->crosses_[c]; }
+inline const RawRoad&  Network::road(const int r)  const { return this->roads_[r]; }
+inline const RawCar&   Network::car(const int i)   const { return this->cars_[i]; }
+
+inline const std::vector<RawPresetCar>&
+Network::preset_cars()
+  const
+{
+  return this->preset_cars_;
+}
+
+inline int Network::cross_index(const int id) const { return this->cross_id_to_index_(id); }
+inline int Network::road_index(const int id)  const { return this->road_id_to_index_(id); }
+inline int Network::car_index(const int id)   const { return this->car_id_to_index_(id); }
+inline int Network::preset_index(const int i) const { return this->preset_index_[i]; }
+
+inline int Network::road_from(const int r) const { return this->road_from_[r]; }
+inline int Network::road_to(const int r)   const { return this->road_to_[r]; }
+inline int Network::car_from(const int i)  const { return this->car_from_[i]; }
+inline int Network::car_to(const int i)    const { return this->car_to_[i]; }
+
+inline int
+Network::cross_road(const int c,
+                    const int slot)
+  const
+{
+  return this->cross_road_[c * 4 + slot];
+}
+
+inline int
+Network::other_end(const int r,
+                   const int c)
+  const
+{
+  return this->road_from_[r] == c ? this->road_to_[r] : this->road_from_[r];
+}
+
+inline int
+Network::shared_cross(const int r1,
+                      const int r2)
+  const
+{
+  int a = this->road_from_[r1], b = this->road_to_[r1];
+  if (a == this->road_from_[r2] || a == this->road_to_[r2]) return a;
+  if (b == this->road_from_[r2] || b == this->road_to_[r2]) return b;
+  return -1;
+}
+
+inline bool
+Network::edge_valid(const int e)
+  const
+{
+  return (e & 1) == 0 || this->roads_[e >> 1].is_duplex != 0;
+}
+
+inline int Network::edge_road(const int e) const { return e >> 1; }
+inline int Network::edge_from(const int e) const { return (e & 1) ? this->road_to_[e >> 1] : this->road_from_[e >> 1]; }
+inline int Network::edge_to(const int e)   const { return (e & 1) ? this->road_from_[e >> 1] : this->road_to_[e >> 1]; }
+
+inline int
+Network::edge_of(const int r,
+                 const int c)
+  const
+{
+  if (this->road_from_[r] == c) return 2 * r;
+  if (this->road_to_[r] == c && this->roads_[r].is_duplex != 0) return 2 * r + 1;
+  return -1;
+}
+
+inline int
+Network::edge_between(const int u,
+                      const int v)
+  const
+{
+  // NOTE: at most 4 roads per cross.
+  for (auto e = this->out_begin(u); e != this->out_end(u); ++e) {
+    if (this->edge_to(*e) == v) {
+      return *e;
+    }
+  }
+  return -1;
+}
+
+inline const int*
+Network::out_begin(const int c)
+  const
+{
+  return this->out_edge_.data() + this->out_offset_[c];
+}
+
+inline const int*
+Network::out_end(const int c)
+  const
+{
+  return this->out_edge_.data() + this->out_offset_[c + 1];
+}
+
+inline int
+Network::speed_class(const int speed)
+  const
+{
+  int v = speed < this->max_road_speed_ ? speed : this->max_road_speed_;
+  return (v > 0 && v < (int) this->speed_to_class_.size()) ? this->speed_to_class_[v] : -1;
+}
+
+inline int
+Network::speed_class_size()
+  const
+{
+  return this->edge_time_.size();
+}
+
+inline int
+Network::travel_time(const int e,
+                     const int speed)
+  const
+{
+  int cls = this->speed_class(speed);
+  if (cls >= 0) {
+    return this->edge_time_[cls][e];
+  }
+  const RawRoad &r = this->roads_[e >> 1];
+  int min_v = speed < r.speed ? speed : r.speed;
+  return (r.len + min_v - 1) / min_v;
+}
+
+inline const int*
+Network::edge_time(const int cls)
+  const
+{
+  return this->edge_time_[cls].data();
+}
+
+inline const int*
+Network::out_time(const int cls,
+                  const int c)
+  const
+{
+  return this->out_time_[cls].data() + this->out_offset_[c];
+}
+/*}}}*/
+
+#endif // ifndef _NETWORK_HPP_
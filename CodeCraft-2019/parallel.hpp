@@ -0,0 +1,154 @@
+/*
+ * parallel.hpp
+ * Copyright (C) 2019 Guowei Chen <icgw@outlook.com>
+ *
+ * Distributed under terms of the GPL license.
+ */
+
+#ifndef _PARALLEL_HPP_
+#define _PARALLEL_HPP_
+
+#include <algorithm> // std::min, std::max
+#include <atomic>
+#include <condition_variable>
+#include <functional> // std::function
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// NOTE: run fn(i, tid) for i in [0, n) on `threads` workers (tid in [0, threads)).
+//   -- tasks are taken one by one from a shared counter, so uneven tasks balance.
+template <class F>
+void
+parallel_for(const int n,
+             const int threads,
+             F fn)
+{
+  int workers = std::max(1, std::min(threads, n));
+  if (workers <= 1) {
+    for (auto i = 0; i < n; ++i) {
+      fn(i, 0);
+    }
+    return;
+  }
+
+  std::atomic<int> next(0);
+  auto run = [&](const int tid) {
+    int i;
+    while ((i = next.fetch_add(1)) < n) {
+      fn(i, tid);
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (auto t = 1; t < workers; ++t) {
+    pool.push_back(std::thread(run, t));
+  }
+  run(0);
+  for (auto &t : pool) {
+    t.join();
+  }
+  return;
+}
+
+// NOTE: workers kept alive across calls, for loops too short to pay a thread
+//       start each time (e.g. one per tick). run(fn) calls fn(tid) once for
+//       each tid in [0, size()), the caller itself being tid 0, and returns
+//       when all are done. the split of the work over tid is up to fn.
+class WorkerPool {
+public:
+  explicit WorkerPool(const int threads);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  int size() const { return this->size_; }
+
+  void run(const std::function<void(int)> &fn);
+
+private:
+  void work(const int tid);
+
+  int                              size_;
+  std::vector<std::thread>         pool_;
+  std::mutex                       mtx_;
+  std::condition_variable          start_, done_;
+  const std::function<void(int)>  *fn_;
+  long long                        round_;
+  int                              pending_;
+  bool                             stop_;
+};
+
+inline
+WorkerPool::WorkerPool(const int threads)
+  : size_(std::max(1, threads)), fn_(nullptr), round_(0), pending_(0), stop_(false)
+{
+  for (auto t = 1; t < this->size_; ++t) {
+    this->pool_.push_back(std::thread(&WorkerPool::work, this, t));
+  }
+}
+
+inline
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mtx_);
+    this->stop_ = true;
+  }
+  this->start_.notify_all();
+  for (auto &t : this->pool_) {
+    t.join();
+  }
+}
+
+inline void
+WorkerPool::run(const std::function<void(int)> &fn)
+{
+  if (this->size_ <= 1) {
+    fn(0);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->mtx_);
+    this->fn_      = &fn;
+    this->pending_ = this->size_ - 1;
+    ++(this->round_);
+  }
+  this->start_.notify_all();
+
+  fn(0);
+
+  std::unique_lock<std::mutex> lock(this->mtx_);
+  this->done_.wait(lock, [this]() { return 0 == this->pending_; });
+  this->fn_ = nullptr;
+  return;
+}
+
+inline void
+WorkerPool::work(const int tid)
+{
+  long long seen = 0;
+  while (true) {
+    const std::function<void(int)> *fn = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(this->mtx_);
+      this->start_.wait(lock, [&]() { return this->stop_ || this->round_ != seen; });
+      if (this->stop_) {
+        return;
+      }
+      seen = this->round_;
+      fn   = this->fn_;
+    }
+
+    (*fn)(tid);
+
+    std::lock_guard<std::mutex> lock(this->mtx_);
+    if (0 == --(this->pending_)) {
+      this->done_.notify_one();
+    }
+  }
+}
+
+#endif // ifndef _PARALLEL_HPP_
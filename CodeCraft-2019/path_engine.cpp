@@ -0,0 +1,284 @@
+/*
+ * path_engine.cpp
+ * Copyright (C) 2019 Guowei Chen <icgw@outlook.com>
+ *
+ * Distributed under terms of the GPL license.
+ */
+
+#include <limits>     // std::numeric_limits<double>::infinity()
+#include <queue>      // std::priority_queue
+#include <functional> // std::greater
+
+#include "path_engine.hpp"
+#include "parallel.hpp"
+#include "profile.hpp"
+
+PathEngine::PathEngine(const Network &network,
+                       const int k,
+                       const double max_overlap,
+                       const int threads)
+  : network_(network)
+  , k_(std::max(1, std::min(k, 30)))
+  , max_overlap_(max_overlap)
+  , penalty_(0.5)
+  , threads_(std::max(1, threads))
+  , stop_(nullptr)
+{
+}
+
+int
+PathEngine::slot(const int from,
+                 const int to,
+                 const int speed)
+{
+  long long key = this->pack(from, to, speed);
+  auto it = this->key_to_slot_.find(key);
+  if (it != this->key_to_slot_.end()) {
+    return it->second;
+  }
+
+  int idx = this->keys_.size();
+  this->key_to_slot_[key] = idx;
+  this->keys_.push_back(Key{ from, to, speed });
+  this->routes_.push_back(std::vector<Route>());
+  this->pending_.push_back(idx);
+  return idx;
+}
+
+void
+PathEngine::request(const int from,
+                    const int to,
+                    const int speed)
+{
+  this->slot(from, to, speed);
+  return;
+}
+
+// NOTE: route all pending OD pairs, one OD pair per task.
+void
+PathEngine::generate()
+{
+  PROFILE_PHASE("path_engine");
+
+  std::vector<int> pending;
+  pending.swap(this->pending_);
+  if (pending.empty()) {
+    return;
+  }
+
+  int workers  = std::max(1, std::min(this->threads_, (int) pending.size()));
+  int edge_sz  = this->network_.edge_size();
+  std::vector<SearchBuffer>        bufs(workers);
+  std::vector<std::vector<double>> weights(workers, std::vector<double>(edge_sz, 1.0));
+  std::vector<std::vector<int>>    marks(workers, std::vector<int>(edge_sz, 0));
+
+  parallel_for(pending.size(), workers, [&](const int i, const int tid) {
+    int idx = pending[i];
+    this->search(this->keys_[idx], this->routes_[idx], bufs[tid], weights[tid], marks[tid]);
+  });
+  return;
+}
+
+const std::vector<Route>&
+PathEngine::get(const int from,
+                const int to,
+                const int speed)
+{
+  int idx = this->slot(from, to, speed);
+  if (!this->pending_.empty()) {
+    this->generate();
+  }
+  return this->routes_[idx];
+}
+
+template <bool HAS_BASE, bool HAS_FACTOR>
+void
+PathEngine::relax_all(const int from,
+                      const int to,
+                      const int *ticks,
+                      const std::vector<double> &factor,
+                      SearchBuffer &buf)
+  const
+{
+  typedef std::pair<double, int> Item;
+  const double inf = std::numeric_limits<double>::infinity();
+
+  std::priority_queue<Item, std::vector<Item>, std::greater<Item>> pq;
+  buf.dist[from] = 0.0;
+  buf.touched.push_back(from);
+  pq.push(Item(0.0, from));
+  PROFILE_COUNT(heap_push, 1);
+  long long settled = 0;
+
+  while (!pq.empty()) {
+    Item top = pq.top();
+    pq.pop();
+    PROFILE_COUNT(heap_pop, 1);
+    int u = top.second;
+    if (top.first > buf.dist[u]) {
+      continue;
+    }
+    ++settled;
+    if (u == to) {
+      break;
+    }
+    const int *first = this->network_.out_begin(u);
+    const int *last  = this->network_.out_end(u);
+    const int *tick  = ticks + (first - this->network_.out_begin(0));
+    for (auto e = first; e != last; ++e, ++tick) {
+      PROFILE_COUNT(edge_relax, 1);
+      double w = *tick;
+      if (HAS_BASE)   w *= this->base_factor_[*e];
+      if (HAS_FACTOR) w *= factor[*e];
+      int v = this->network_.edge_to(*e);
+      if (buf.dist[u] + w < buf.dist[v]) {
+        if (buf.dist[v] == inf) {
+          buf.touched.push_back(v);
+        }
+        buf.dist[v]  = buf.dist[u] + w;
+        buf.trace[v] = *e;
+        pq.push(Item(buf.dist[v], v));
+        PROFILE_COUNT(heap_push, 1);
+      }
+    }
+  }
+  PROFILE_QUERY(settled);
+  return;
+}
+
+bool
+PathEngine::shortest(const int from,
+                     const int to,
+                     const int speed,
+                     const std::vector<double> &factor,
+                     SearchBuffer &buf,
+                     Route &route)
+  const
+{
+  const double inf = std::numeric_limits<double>::infinity();
+
+  if ((int) buf.dist.size() != this->network_.cross_size()) {
+    buf.dist.assign(this->network_.cross_size(), inf);
+    buf.trace.assign(this->network_.cross_size(), -1);
+    buf.touched.clear();
+  }
+
+  // NOTE: a speed no car has gets a table for this query only.
+  std::vector<int> local;
+  int cls = this->network_.speed_class(speed);
+  const int *ticks = nullptr;
+  if (cls >= 0) {
+    ticks = this->network_.out_time(cls, 0);
+  } else {
+    const int *first = this->network_.out_begin(0);
+    const int *last  = this->network_.out_end(this->network_.cross_size() - 1);
+    for (auto e = first; e != last; ++e) {
+      local.push_back(this->network_.travel_time(*e, speed));
+    }
+    ticks = local.data();
+  }
+
+  bool has_base = !this->base_factor_.empty(), has_factor = !factor.empty();
+  if (has_base && has_factor) {
+    this->relax_all<true, true>(from, to, ticks, factor, buf);
+  } else if (has_base) {
+    this->relax_all<true, false>(from, to, ticks, factor, buf);
+  } else if (has_factor) {
+    this->relax_all<false, true>(from, to, ticks, factor, buf);
+  } else {
+    this->relax_all<false, false>(from, to, ticks, factor, buf);
+  }
+
+  bool found = (from == to) || buf.trace[to] >= 0;
+  route.cross_seq.clear();
+  route.edges.clear();
+  route.cost = 0;
+  if (found) {
+    for (int c = to; c != from; c = this->network_.edge_from(buf.trace[c])) {
+      route.edges.push_back(buf.trace[c]);
+    }
+    std::reverse(route.edges.begin(), route.edges.end());
+    route.cross_seq.push_back(from);
+    for (auto e : route.edges) {
+      route.cross_seq.push_back(this->network_.edge_to(e));
+      route.cost += this->travel_time(e, speed);
+    }
+  }
+
+  // NOTE: reset the buffer for the next query.
+  for (auto u : buf.touched) {
+    buf.dist[u]  = inf;
+    buf.trace[u] = -1;
+  }
+  buf.touched.clear();
+  return found;
+}
+
+void
+PathEngine::search(const Key &key,
+                   std::vector<Route> &routes,
+                   SearchBuffer &buf,
+                   std::vector<double> &weight,
+                   std::vector<int> &mark)
+  const
+{
+  routes.clear();
+  if (key.from == key.to) {
+    Route r; r.cross_seq.push_back(key.from); r.cost = 0;
+    routes.push_back(r);
+    return;
+  }
+
+  std::vector<int> touched_edge;
+  int max_try = this->k_ * 3;
+  for (auto tries = 0; tries < max_try && (int) routes.size() < this->k_; ++tries) {
+    if (!routes.empty() && this->stop_ != nullptr && this->stop_->load()) {
+      break;
+    }
+    Route r;
+    if (!this->shortest(key.from, key.to, key.speed, weight, buf, r)) {
+      break; // XXX: unreachable.
+    }
+
+    /*{{{ overlap with accepted routes, measured by road length */
+    std::vector<int> shared(routes.size(), 0);
+    int total = 0;
+    for (auto e : r.edges) {
+      int len = this->network_.road(this->network_.edge_road(e)).len;
+      total += len;
+      for (auto i = 0; i < (int) routes.size(); ++i) {
+        if (mark[e] & (1 << i)) {
+          shared[i] += len;
+        }
+      }
+    }
+    bool is_diverse = true;
+    for (auto s : shared) {
+      if (s >= total || s > this->max_overlap_ * total) {
+        is_diverse = false;
+        break;
+      }
+    }
+    /*}}}*/
+
+    for (auto e : r.edges) {
+      if (weight[e] == 1.0) {
+        touched_edge.push_back(e);
+      }
+      weight[e] *= 1.0 + this->penalty_;
+      if (is_diverse) {
+        mark[e] |= 1 << routes.size();
+      }
+    }
+    if (is_diverse) {
+      routes.push_back(r);
+    }
+  }
+
+  // NOTE: reset the buffers for the next OD pair.
+  for (auto e : touched_edge) {
+    weight[e] = 1.0;
+    mark[e]   = 0;
+  }
+  return;
+}
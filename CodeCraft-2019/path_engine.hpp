@@ -0,0 +1,153 @@
+/*
+ * path_engine.hpp
+ * Copyright (C) 2019 Guowei Chen <icgw@outlook.com>
+ *
+ * Distributed under terms of the GPL license.
+ */
+
+#ifndef _PATH_ENGINE_HPP_
+#define _PATH_ENGINE_HPP_
+
+#include <algorithm> // std::min
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+
+#include "network.hpp"
+
+// NOTE: one loopless route between two crosses.
+//   -- cross_seq: cross index sequence (from ... to).
+//   -- edges:     directed road index of each hop.
+//   -- cost:      free-flow travel time of the speed class.
+struct Route {
+  std::vector<int> cross_seq;
+  std::vector<int> edges;
+  int              cost;
+};
+
+/*
+ * NOTE: K diverse alternative routes per (from, to, speed).
+ *   -- penalty method: after each accepted route, the weight of its roads is
+ *      multiplied by (1 + penalty_), a candidate is accepted only if it shares
+ *      at most `max_overlap_` of its length with every accepted route.
+ *   -- `request()` collects OD pairs, `generate()` routes them in parallel,
+ *      `get()` returns the cached routes (computed on a miss), the reference
+ *      stays valid while the engine lives.
+ */
+class PathEngine {
+public:
+  PathEngine(const Network &network, const int k, const double max_overlap, const int threads);
+
+  void request(const int from, const int to, const int speed);
+  void generate();
+
+  const std::vector<Route>& get(const int from, const int to, const int speed);
+
+  // NOTE: free-flow travel time of a directed road for the speed.
+  int travel_time(const int e, const int speed) const;
+
+  // NOTE: observed delay factor per directed road (e.g. from the judge), empty for free flow.
+  //       set it before `generate()`.
+  void set_base_factor(const std::vector<double> &factor);
+
+  // NOTE: when `stop` is raised, an OD pair still to route keeps its shortest
+  //       route alone, so every pair has one and the plan stays complete.
+  void set_stop(const std::atomic<bool> *stop);
+
+  // NOTE: travel time scaled by the base factor, the weight every search starts from.
+  double edge_cost(const int e, const int speed) const;
+
+  const Network& network() const { return this->network_; }
+  bool has_base_factor() const { return !this->base_factor_.empty(); }
+
+  // NOTE: the search state of one thread, reused across queries.
+  struct SearchBuffer {
+    std::vector<double> dist;
+    std::vector<int>    trace;
+    std::vector<int>    touched;
+  };
+
+  // NOTE: shortest route with weight `edge_cost(e, speed) * factor[e]` (1.0 if `factor`
+  //       is empty), false if unreachable. thread-safe with one buffer per thread.
+  bool shortest(const int from, const int to, const int speed,
+                const std::vector<double> &factor, SearchBuffer &buf, Route &route) const;
+
+private:
+  PathEngine() = delete;
+
+  struct Key {
+    int from, to, speed;
+  };
+
+  long long pack(const int from, const int to, const int speed) const;
+  int       slot(const int from, const int to, const int speed);
+
+  // NOTE: the dijkstra loop, `ticks` is parallel to the out-edges of the network.
+  //   -- specialized on the multipliers present, so the plain free-flow case relaxes
+  //      an edge with a load and an add.
+  template <bool HAS_BASE, bool HAS_FACTOR>
+  void relax_all(const int from, const int to, const int *ticks,
+                 const std::vector<double> &factor, SearchBuffer &buf) const;
+
+  // NOTE: penalty method for one OD pair, buffers belong to the calling thread.
+  void search(const Key &key, std::vector<Route> &routes, SearchBuffer &buf,
+              std::vector<double> &weight, std::vector<int> &mark) const;
+
+  const Network &network_;
+  int            k_;
+  double         max_overlap_;
+  double         penalty_;
+  int            threads_;
+
+  std::vector<double> base_factor_;
+  const std::atomic<bool> *stop_;
+
+  std::unordered_map<long long, int> key_to_slot_;
+  std::vector<Key>                   keys_;
+  std::deque<std::vector<Route>>     routes_;
+  std::vector<int>                   pending_;
+};
+
+inline int
+PathEngine::travel_time(const int e,
+                        const int speed)
+  const
+{
+  return this->network_.travel_time(e, speed);
+}
+
+inline void
+PathEngine::set_base_factor(const std::vector<double> &factor)
+{
+  this->base_factor_ = factor;
+  return;
+}
+
+inline void
+PathEngine::set_stop(const std::atomic<bool> *stop)
+{
+  this->stop_ = stop;
+  return;
+}
+
+inline double
+PathEngine::edge_cost(const int e,
+                      const int speed)
+  const
+{
+  return this->base_factor_.empty() ? this->travel_time(e, speed)
+                                    : this->travel_time(e, speed) * this->base_factor_[e];
+}
+
+inline long long
+PathEngine::pack(const int from,
+                 const int to,
+                 const int speed)
+  const
+{
+  long long n = this->network_.cross_size();
+  return ((long long) speed * n + from) * n + to;
+}
+
+#endif // ifndef _PATH_ENGINE_HPP_
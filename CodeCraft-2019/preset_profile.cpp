@@ -0,0 +1,106 @@
+/*
+ * preset_profile.cpp
+ * Copyright (C) 2019 Guowei Chen <icgw@outlook.com>
+ *
+ * Distributed under terms of the GPL license.
+ */
+
+#include <iostream>
+#include <fstream> // std::ifstream
+#include <sstream> // std::ostringstream
+#include <iomanip> // std::hex, std::setw
+
+#include "preset_profile.hpp"
+#include "network.hpp"
+#include "judge/judge.hpp"
+
+namespace {
+
+// NOTE: FNV-1a 64 over the bytes of the file, continued from `h`.
+std::uint64_t
+fnv1a_file(const std::string &path,
+           std::uint64_t h)
+{
+  std::ifstream fin(path, std::ios::binary);
+  char buf[1 << 16];
+  while (fin) {
+    fin.read(buf, sizeof(buf));
+    std::streamsize n = fin.gcount();
+    for (std::streamsize i = 0; i < n; ++i) {
+      h ^= (unsigned char) buf[i];
+      h *= 1099511628211ull;
+    }
+  }
+  return h;
+}
+
+} // namespace
+
+PresetProfile::PresetProfile(const std::string &car_path,
+                             const std::string &road_path,
+                             const std::string &cross_path,
+                             const std::string &preset_path)
+  : car_path_(car_path)
+  , road_path_(road_path)
+  , cross_path_(cross_path)
+  , preset_path_(preset_path)
+  , key_(14695981039346656037ull)
+  , is_cached_(false)
+{
+  // NOTE: the preset file first, the map files can only refine the key.
+  this->key_ = fnv1a_file(this->preset_path_, this->key_);
+  this->key_ = fnv1a_file(this->car_path_,    this->key_);
+  this->key_ = fnv1a_file(this->road_path_,   this->key_);
+  this->key_ = fnv1a_file(this->cross_path_,  this->key_);
+}
+
+std::string
+PresetProfile::cache_file(const std::string &cache_dir)
+  const
+{
+  std::ostringstream oss;
+  oss << cache_dir << "/preset-" << std::hex << std::setw(16) << std::setfill('0') << this->key_ << ".occ";
+  return oss.str();
+}
+
+bool
+PresetProfile::load(const std::string &cache_dir)
+{
+  this->rows_.clear();
+  this->is_cached_ = false;
+
+  if (!cache_dir.empty()) {
+    // NOTE: an empty profile is cached as a missing file, it is cheap to redo.
+    read_from_file(this->cache_file(cache_dir), OCCUPANCY_SIZE, this->rows_);
+    if (!this->rows_.empty()) {
+      this->is_cached_ = true;
+      return true;
+    }
+  }
+
+  this->simulate();
+  if (!cache_dir.empty() && !this->rows_.empty()) {
+    write_to_file(this->cache_file(cache_dir), this->rows_);
+  }
+  return !this->rows_.empty();
+}
+
+void
+PresetProfile::simulate()
+{
+  // NOTE: no answer file, only the preset cars are routed.
+  Judge judge(this->car_path_, this->road_path_, this->cross_path_, this->preset_path_, "");
+
+  int timer = 0;
+  while (!judge.is_finish()) {
+    ++timer;
+    if (!judge.step(timer)) {
+      // XXX: the presets deadlock alone, keep the profile so far.
+      std::cout << "preset profile: deadlock at " << timer << std::endl;
+      break;
+    }
+    judge.record_occupancy(timer);
+  }
+  this->rows_ = judge.occupancy_table();
+  return;
+}
@@ -0,0 +1,63 @@
+/*
+ * preset_profile.hpp
+ * Copyright (C) 2019 Guowei Chen <icgw@outlook.com>
+ *
+ * Distributed under terms of the GPL license.
+ */
+
+#ifndef _PRESET_PROFILE_HPP_
+#define _PRESET_PROFILE_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * NOTE: the occupancy of every directed road per tick when the preset cars run
+ *       alone through the judge engine, rows as OCCUPANCY_* in network.hpp.
+ *   -- the rows are cached in `cache_dir` (not if empty), the file is keyed by
+ *      the FNV-1a hash of the preset file, and of the car, road, cross files
+ *      the simulation also depends on.
+ *   -- a deadlock of the presets alone ends the profile at that tick.
+ */
+class PresetProfile {
+public:
+  PresetProfile(const std::string &car_path,
+                const std::string &road_path,
+                const std::string &cross_path,
+                const std::string &preset_path);
+
+  // NOTE: load from the cache or simulate (and store), false if nothing to profile.
+  bool load(const std::string &cache_dir);
+
+  const std::vector<std::vector<int>>& rows() const;
+  bool is_cached() const;
+
+private:
+  PresetProfile() = delete;
+
+  void simulate();
+
+  std::string cache_file(const std::string &cache_dir) const;
+
+  std::string                   car_path_, road_path_, cross_path_, preset_path_;
+  std::uint64_t                 key_;
+  bool                          is_cached_;
+  std::vector<std::vector<int>> rows_;
+};
+
+inline const std::vector<std::vector<int>>&
+PresetProfile::rows()
+  const
+{
+  return this->rows_;
+}
+
+inline bool
+PresetProfile::is_cached()
+  const
+{
+  return this->is_cached_;
+}
+
+#endif // ifndef _PRESET_PROFILE_HPP_
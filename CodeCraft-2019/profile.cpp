@@ -0,0 +1,141 @@
+/*
+ * profile.cpp
+ * Copyright (C) 2019 Guowei Chen <icgw@outlook.com>
+ *
+ * Distributed under terms of the GPL license.
+ */
+
+#include "profile.hpp"
+
+#ifdef CODECRAFT_PROFILE
+
+#include <cstdlib>   // std::malloc, std::free
+#include <fstream>   // std::ofstream
+#include <mutex>     // std::mutex, std::lock_guard
+#include <new>       // std::bad_alloc
+#include <vector>
+
+namespace profile {
+
+/*{{{ phases and counters */
+struct PhaseRecord {
+  std::string name;
+  long long   calls;
+  double      ms;
+};
+
+// NOTE: zero-initialized before any dynamic initialization, `operator new` may count into it.
+static Counters g_counters;
+
+static std::mutex&
+phase_mutex()
+{
+  static std::mutex m;
+  return m;
+}
+
+// NOTE: kept in order of first appearance.
+static std::vector<PhaseRecord>&
+phases()
+{
+  static std::vector<PhaseRecord> v;
+  return v;
+}
+
+Counters&
+counters()
+{
+  return g_counters;
+}
+
+void
+add_phase(const char *name,
+          const double ms)
+{
+  std::lock_guard<std::mutex> lock(phase_mutex());
+  for (auto &p : phases()) {
+    if (p.name == name) {
+      ++p.calls;
+      p.ms += ms;
+      return;
+    }
+  }
+  phases().push_back(PhaseRecord{ name, 1, ms });
+  return;
+}
+
+void
+record_query(const long long settled)
+{
+  g_counters.query.fetch_add(1, std::memory_order_relaxed);
+  g_counters.settled.fetch_add(settled, std::memory_order_relaxed);
+  long long prev = g_counters.settled_max.load(std::memory_order_relaxed);
+  while (prev < settled &&
+         !g_counters.settled_max.compare_exchange_weak(prev, settled, std::memory_order_relaxed)) {}
+  return;
+}
+/*}}}*/
+
+// NOTE: write phases and counters as JSON into `path`.
+void
+report(const std::string &path)
+{
+  std::ofstream fout(path, std::fstream::out);
+  if (!fout.is_open()) {
+    return;
+  }
+
+  long long query   = g_counters.query.load();
+  long long settled = g_counters.settled.load();
+
+  std::lock_guard<std::mutex> lock(phase_mutex());
+  fout << "{\n  \"phases\": [";
+  auto sz = phases().size();
+  for (std::size_t i = 0; i < sz; ++i) {
+    fout << (i == 0 ? "\n" : ",\n")
+         << "    { \"name\": \"" << phases()[i].name << "\""
+         << ", \"calls\": "      << phases()[i].calls
+         << ", \"ms\": "         << phases()[i].ms << " }";
+  }
+  fout << "\n  ],\n"
+       << "  \"counters\": {\n"
+       << "    \"heap_push\": "   << g_counters.heap_push.load()   << ",\n"
+       << "    \"heap_pop\": "    << g_counters.heap_pop.load()    << ",\n"
+       << "    \"edge_relax\": "  << g_counters.edge_relax.load()  << ",\n"
+       << "    \"alloc\": "       << g_counters.alloc.load()       << ",\n"
+       << "    \"alloc_bytes\": " << g_counters.alloc_bytes.load() << "\n"
+       << "  },\n"
+       << "  \"queries\": {\n"
+       << "    \"count\": "       << query                                         << ",\n"
+       << "    \"settled\": "     << settled                                       << ",\n"
+       << "    \"settled_avg\": " << (query > 0 ? (double) settled / query : 0.0) << ",\n"
+       << "    \"settled_max\": " << g_counters.settled_max.load()              << "\n"
+       << "  }\n"
+       << "}\n";
+  fout.close();
+  return;
+}
+
+} // namespace profile
+
+/*{{{ count every heap allocation */
+void*
+operator new(std::size_t n)
+{
+  profile::g_counters.alloc.fetch_add(1, std::memory_order_relaxed);
+  profile::g_counters.alloc_bytes.fetch_add(n, std::memory_order_relaxed);
+  void *p = std::malloc(n == 0 ? 1 : n);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void
+operator delete(void *p) noexcept
+{
+  std::free(p);
+}
+/*}}}*/
+
+#endif // ifdef CODECRAFT_PROFILE
@@ -0,0 +1,82 @@
+/*
+ * profile.hpp
+ * Copyright (C) 2019 Guowei Chen <icgw@outlook.com>
+ *
+ * Distributed under terms of the GPL license.
+ */
+
+#ifndef _PROFILE_HPP_
+#define _PROFILE_HPP_
+
+/*
+ * NOTE: phase timing and hot-path counters of the solver.
+ *   -- enabled by defining CODECRAFT_PROFILE (cmake -DENABLE_PROFILE=ON),
+ *      otherwise every PROFILE_* macro expands to nothing.
+ *
+ *   PROFILE_PHASE("name");         // wall time until the end of the scope.
+ *   PROFILE_COUNT(heap_push, 1);   // add to a counter of `profile::Counters`.
+ *   PROFILE_QUERY(settled);        // one shortest path query settled `n` nodes.
+ *   PROFILE_REPORT("report.json"); // dump everything as JSON.
+ */
+
+#ifdef CODECRAFT_PROFILE
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+namespace profile {
+
+struct Counters {
+  std::atomic<long long> heap_push;
+  std::atomic<long long> heap_pop;
+  std::atomic<long long> edge_relax;
+  std::atomic<long long> query;
+  std::atomic<long long> settled;
+  std::atomic<long long> settled_max;
+  std::atomic<long long> alloc;
+  std::atomic<long long> alloc_bytes;
+};
+
+Counters& counters();
+
+void add_phase(const char *name, const double ms);
+void record_query(const long long settled);
+void report(const std::string &path);
+
+// NOTE: RAII timer, record the wall time of a phase when leaving its scope.
+class Phase {
+public:
+  explicit Phase(const char *name)
+    : name_(name)
+    , begin_(std::chrono::steady_clock::now()) {}
+
+  ~Phase() {
+    std::chrono::duration<double, std::milli> d = std::chrono::steady_clock::now() - this->begin_;
+    add_phase(this->name_, d.count());
+  }
+
+private:
+  const char                           *name_;
+  std::chrono::steady_clock::time_point begin_;
+};
+
+} // namespace profile
+
+#define PROFILE_CONCAT_(a, b)     a##b
+#define PROFILE_CONCAT(a, b)      PROFILE_CONCAT_(a, b)
+#define PROFILE_PHASE(name)       profile::Phase PROFILE_CONCAT(profile_phase_, __LINE__)(name)
+#define PROFILE_COUNT(counter, n) (profile::counters().counter.fetch_add((n), std::memory_order_relaxed))
+#define PROFILE_QUERY(settled)    profile::record_query(settled)
+#define PROFILE_REPORT(path)      profile::report(path)
+
+#else
+
+#define PROFILE_PHASE(name)
+#define PROFILE_COUNT(counter, n)
+#define PROFILE_QUERY(settled)
+#define PROFILE_REPORT(path)
+
+#endif // ifdef CODECRAFT_PROFILE
+
+#endif // ifndef _PROFILE_HPP_
@@ -0,0 +1,217 @@
+/*
+ * sssp.cpp
+ * Copyright (C) 2019 Guowei Chen <icgw@outlook.com>
+ *
+ * Distributed under terms of the GPL license.
+ */
+
+#include <atomic>
+#include <queue>      // std::priority_queue
+#include <functional> // std::greater
+#include <utility>    // std::pair
+
+#include "sssp.hpp"
+#include "parallel.hpp"
+#include "profile.hpp"
+
+Sssp::Sssp(const Network &network,
+           const int threads,
+           const int delta)
+  : network_(network)
+  , threads_(std::max(1, threads))
+  , delta_(std::max(1, delta))
+{
+}
+
+const int*
+Sssp::ticks(const int speed,
+            std::vector<int> &local)
+  const
+{
+  int cls = this->network_.speed_class(speed);
+  if (cls >= 0) {
+    return this->network_.edge_time(cls);
+  }
+  int edge_sz = this->network_.edge_size();
+  local.resize(edge_sz);
+  for (auto e = 0; e < edge_sz; ++e) {
+    local[e] = this->network_.travel_time(e, speed);
+  }
+  return local.data();
+}
+
+void
+Sssp::canonical_tree(const int source,
+                     const int *ticks,
+                     std::vector<int> &dist,
+                     std::vector<int> &pred)
+  const
+{
+  int sz = this->network_.cross_size();
+  pred.assign(sz, -1);
+
+  int chunk = 1024;
+  parallel_for((sz + chunk - 1) / chunk, this->threads_, [&](const int t, const int) {
+    int end = std::min(sz, (t + 1) * chunk);
+    for (auto v = t * chunk; v < end; ++v) {
+      if (v == source || dist[v] >= INF) {
+        continue;
+      }
+      // NOTE: roads into `v` are the roads of its slots, seen from the other end.
+      for (auto k = 0; k < 4; ++k) {
+        int r = this->network_.cross_road(v, k);
+        if (r < 0) {
+          continue;
+        }
+        int e = this->network_.edge_of(r, this->network_.other_end(r, v));
+        if (e < 0 || this->network_.edge_to(e) != v) {
+          continue;
+        }
+        int u = this->network_.edge_from(e);
+        if (dist[u] < INF && dist[u] + ticks[e] == dist[v] && (pred[v] < 0 || e < pred[v])) {
+          pred[v] = e;
+        }
+      }
+    }
+  });
+
+  for (auto &d : dist) {
+    if (d >= INF) {
+      d = -1;
+    }
+  }
+  return;
+}
+
+void
+Sssp::dijkstra(const int source,
+               const int speed,
+               std::vector<int> &dist,
+               std::vector<int> &pred)
+  const
+{
+  PROFILE_PHASE("sssp_dijkstra");
+
+  typedef std::pair<int, int> Item;
+  std::vector<int> local;
+  const int *w = this->ticks(speed, local);
+
+  dist.assign(this->network_.cross_size(), INF);
+  std::priority_queue<Item, std::vector<Item>, std::greater<Item>> pq;
+  dist[source] = 0;
+  pq.push(Item(0, source));
+  while (!pq.empty()) {
+    Item top = pq.top();
+    pq.pop();
+    int u = top.second;
+    if (top.first > dist[u]) {
+      continue;
+    }
+    for (auto e = this->network_.out_begin(u); e != this->network_.out_end(u); ++e) {
+      int v = this->network_.edge_to(*e);
+      if (dist[u] + w[*e] < dist[v]) {
+        dist[v] = dist[u] + w[*e];
+        pq.push(Item(dist[v], v));
+      }
+    }
+  }
+
+  this->canonical_tree(source, w, dist, pred);
+  return;
+}
+
+void
+Sssp::delta_stepping(const int source,
+                     const int speed,
+                     std::vector<int> &dist,
+                     std::vector<int> &pred)
+  const
+{
+  PROFILE_PHASE("sssp_delta_stepping");
+
+  std::vector<int> local;
+  const int *w     = this->ticks(speed, local);
+  const int  delta = this->delta_;
+  const int  sz    = this->network_.cross_size();
+
+  std::vector<std::atomic<int>> d(sz);
+  for (auto &x : d) {
+    x.store(INF, std::memory_order_relaxed);
+  }
+
+  // NOTE: buckets hold crosses lazily, an entry is stale once the cross left the bucket.
+  std::vector<std::vector<int>> buckets(1);
+  std::vector<int> stamp(sz, -1);
+  d[source].store(0);
+  buckets[0].push_back(source);
+
+  int workers = this->threads_;
+  std::vector<std::vector<int>> moved(workers);
+
+  // NOTE: relax the light (`is_light`) or heavy edges of `frontier` in parallel,
+  //       then file every improved cross into its bucket.
+  auto relax = [&](const std::vector<int> &frontier, const bool is_light) {
+    int n     = frontier.size();
+    int chunk = 256;
+    parallel_for((n + chunk - 1) / chunk, workers, [&](const int t, const int tid) {
+      int end = std::min(n, (t + 1) * chunk);
+      for (auto i = t * chunk; i < end; ++i) {
+        int u  = frontier[i];
+        int du = d[u].load(std::memory_order_relaxed);
+        for (auto e = this->network_.out_begin(u); e != this->network_.out_end(u); ++e) {
+          if ((w[*e] <= delta) != is_light) {
+            continue;
+          }
+          int v   = this->network_.edge_to(*e);
+          int nd  = du + w[*e];
+          int cur = d[v].load(std::memory_order_relaxed);
+          while (nd < cur && !d[v].compare_exchange_weak(cur, nd, std::memory_order_relaxed)) {
+          }
+          if (nd < cur) {
+            moved[tid].push_back(v);
+          }
+        }
+      }
+    });
+    for (auto &m : moved) {
+      for (auto v : m) {
+        int b = d[v].load(std::memory_order_relaxed) / delta;
+        if (b >= (int) buckets.size()) {
+          buckets.resize(b + 1);
+        }
+        buckets[b].push_back(v);
+      }
+      m.clear();
+    }
+  };
+
+  std::vector<int> frontier, settled;
+  for (auto i = 0; i < (int) buckets.size(); ++i) {
+    settled.clear();
+    while (!buckets[i].empty()) {
+      frontier.clear();
+      for (auto v : buckets[i]) {
+        // NOTE: skip stale entries and duplicates of this round.
+        if (d[v].load(std::memory_order_relaxed) / delta == i && stamp[v] != i) {
+          stamp[v] = i;
+          frontier.push_back(v);
+        }
+      }
+      buckets[i].clear();
+      settled.insert(settled.end(), frontier.begin(), frontier.end());
+      relax(frontier, true);
+      // NOTE: a cross re-entering the bucket is relaxed again.
+      for (auto v : buckets[i]) {
+        stamp[v] = -1;
+      }
+    }
+    relax(settled, false);
+  }
+
+  dist.resize(sz);
+  for (auto v = 0; v < sz; ++v) {
+    dist[v] = d[v].load(std::memory_order_relaxed);
+  }
+  this->canonical_tree(source, w, dist, pred);
+  return;
+}
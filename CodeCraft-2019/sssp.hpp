@@ -0,0 +1,52 @@
+/*
+ * sssp.hpp
+ * Copyright (C) 2019 Guowei Chen <icgw@outlook.com>
+ *
+ * Distributed under terms of the GPL license.
+ */
+
+#ifndef _SSSP_HPP_
+#define _SSSP_HPP_
+
+#include <vector>
+
+#include "network.hpp"
+
+/*
+ * NOTE: single-source free-flow travel time to every cross.
+ *   -- `dijkstra`: serial, binary heap.
+ *   -- `delta_stepping`: buckets of width `delta` ticks, the edges of a bucket
+ *      are relaxed in parallel (light edges until the bucket settles, then
+ *      heavy edges once), distances are lowered with a CAS loop.
+ *   -- both return the same `dist` (-1 if unreachable) and the same canonical
+ *      predecessor tree: pred[v] is the lowest directed road index `e` into `v`
+ *      with dist[from(e)] + ticks(e) == dist[v], -1 for the source.
+ */
+class Sssp {
+public:
+  Sssp(const Network &network, const int threads, const int delta);
+
+  void dijkstra(const int source, const int speed,
+                std::vector<int> &dist, std::vector<int> &pred) const;
+
+  void delta_stepping(const int source, const int speed,
+                      std::vector<int> &dist, std::vector<int> &pred) const;
+
+private:
+  Sssp() = delete;
+
+  enum { INF = 0x3fffffff };
+
+  // NOTE: free-flow ticks per directed road for the speed.
+  const int* ticks(const int speed, std::vector<int> &local) const;
+
+  // NOTE: fill `pred` from the final `dist` (INF --> -1), in parallel over crosses.
+  void canonical_tree(const int source, const int *ticks,
+                      std::vector<int> &dist, std::vector<int> &pred) const;
+
+  const Network &network_;
+  int            threads_;
+  int            delta_;
+};
+
+#endif // ifndef _SSSP_HPP_
@@ -0,0 +1,94 @@
+/*
+ * watchdog.cpp
+ * Copyright (C) 2019 Guowei Chen <icgw@outlook.com>
+ *
+ * Distributed under terms of the GPL license.
+ */
+
+#include <iostream>
+#include <csignal> // std::signal, SIGTERM
+
+#include "watchdog.hpp"
+
+namespace {
+
+// NOTE: only a lock-free flag may be touched in the signal handler.
+//   -- the first SIGTERM asks for a stop, the default action is back for the next.
+std::atomic<bool> g_terminate(false);
+
+extern "C" void
+on_terminate(int)
+{
+  g_terminate.store(true);
+  std::signal(SIGTERM, SIG_DFL);
+}
+
+} // namespace
+
+Watchdog::Watchdog(const int budget_ms)
+  : budget_ms_(budget_ms)
+  , begin_(Clock::now())
+  , last_(Clock::now())
+  , stop_(false)
+  , verbose_(false)
+  , is_done_(false)
+{
+  std::signal(SIGTERM, on_terminate);
+  this->thread_ = std::thread(&Watchdog::watch, this);
+}
+
+Watchdog::~Watchdog()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->is_done_ = true;
+  }
+  this->cv_.notify_all();
+  this->thread_.join();
+  std::signal(SIGTERM, SIG_DFL);
+}
+
+void
+Watchdog::watch()
+{
+  // NOTE: SIGTERM can only be polled, so wake up every few milliseconds.
+  std::unique_lock<std::mutex> lock(this->mutex_);
+  while (!this->is_done_) {
+    if (g_terminate.load()) {
+      if (this->verbose_.load()) {
+        std::cout << "budget: SIGTERM, stopping" << std::endl;
+      }
+      this->stop_.store(true);
+      return;
+    }
+    if (this->budget_ms_ > 0 && Clock::now() - this->begin_ >= std::chrono::milliseconds(this->budget_ms_)) {
+      if (this->verbose_.load()) {
+        std::cout << "budget: " << this->budget_ms_ << " ms expired, stopping" << std::endl;
+      }
+      this->stop_.store(true);
+      std::signal(SIGTERM, SIG_DFL); // nothing polls the flag now.
+      return;
+    }
+    this->cv_.wait_for(lock, std::chrono::milliseconds(5));
+  }
+  return;
+}
+
+void
+Watchdog::log(const char *phase)
+{
+  Clock::time_point now = Clock::now();
+  double ms    = std::chrono::duration<double, std::milli>(now - this->last_).count();
+  double total = std::chrono::duration<double, std::milli>(now - this->begin_).count();
+  this->last_  = now;
+  if (!this->verbose_.load()) {
+    return;
+  }
+
+  std::cout << "budget: " << phase << " " << ms << " ms, total " << total << " ms";
+  if (this->budget_ms_ > 0) {
+    std::cout << " / " << this->budget_ms_ << " ms";
+  }
+  std::cout << std::endl;
+  return;
+}
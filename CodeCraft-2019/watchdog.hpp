@@ -0,0 +1,77 @@
+/*
+ * watchdog.hpp
+ * Copyright (C) 2019 Guowei Chen <icgw@outlook.com>
+ *
+ * Distributed under terms of the GPL license.
+ */
+
+#ifndef _WATCHDOG_HPP_
+#define _WATCHDOG_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/*
+ * NOTE: wall-clock budget of the solver.
+ *   -- a background thread raises `stop()` once `budget_ms` has passed (never
+ *      if 0) or SIGTERM arrives, long phases poll it and return early.
+ *   -- `log()` prints the time of the phase since the last call, and the total.
+ *      it and the stop messages are quiet unless `set_verbose(true)`.
+ */
+class Watchdog {
+public:
+  explicit Watchdog(const int budget_ms);
+  ~Watchdog();
+
+  const std::atomic<bool>& stop() const;
+  bool is_stopped() const;
+
+  void set_verbose(const bool verbose);
+  void log(const char *phase);
+
+private:
+  Watchdog() = delete;
+  Watchdog(const Watchdog&) = delete;
+  Watchdog& operator=(const Watchdog&) = delete;
+
+  typedef std::chrono::steady_clock Clock;
+
+  void watch();
+
+  int                     budget_ms_;
+  Clock::time_point       begin_;
+  Clock::time_point       last_;
+  std::atomic<bool>       stop_;
+  std::atomic<bool>       verbose_;
+
+  bool                    is_done_;
+  std::mutex              mutex_;
+  std::condition_variable cv_;
+  std::thread             thread_;
+};
+
+inline const std::atomic<bool>&
+Watchdog::stop()
+  const
+{
+  return this->stop_;
+}
+
+inline bool
+Watchdog::is_stopped()
+  const
+{
+  return this->stop_.load();
+}
+
+inline void
+Watchdog::set_verbose(const bool verbose)
+{
+  this->verbose_.store(verbose);
+  return;
+}
+
+#endif // ifndef _WATCHDOG_HPP_